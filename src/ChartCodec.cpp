@@ -0,0 +1,68 @@
+#include <cmath>
+#include <cstring>
+
+#include "ChartCodec.h"
+
+namespace ChartCodec {
+	const char MAGIC[4] = { 'A', 'G', 'L', 'V' };
+
+	bool HasMagic(const char* data, const size_t size) {
+		return (size >= sizeof(MAGIC)) && (std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0);
+	}
+
+	void WriteVarint(std::string &output, uint32_t value) {
+		while (value >= 0x80) {
+			output.push_back(char((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		output.push_back(char(value));
+	}
+
+	void WriteString(std::string &output, const std::string &value) {
+		WriteVarint(output, uint32_t(value.size()));
+		output.append(value);
+	}
+
+	bool ReadVarint(const char* &cursor, const char* const end, uint32_t &value) {
+		// Single byte fast path, covers most note durations and deltas
+		if ((cursor < end) && !(*cursor & 0x80)) {
+			value = uint8_t(*cursor++);
+			return true;
+		}
+
+		value = 0;
+		for (unsigned int shift = 0; shift < 35; shift += 7) {
+			if (cursor >= end) {
+				return false;
+			}
+			const uint8_t byte = uint8_t(*cursor++);
+			// Only the 4 lowest bits of a 5th byte still fit in 32 bits
+			if ((shift == 28) && (byte & 0xF0)) {
+				return false;
+			}
+			value |= uint32_t(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) {
+				return true;
+			}
+		}
+		return false; // More than 5 bytes can't be a 32-bit value
+	}
+
+	bool ReadString(const char* &cursor, const char* const end, std::string &value) {
+		uint32_t length;
+		if (!ReadVarint(cursor, end, length) || (length > size_t(end - cursor))) {
+			return false;
+		}
+		value.assign(cursor, length);
+		cursor += length;
+		return true;
+	}
+
+	uint32_t SecondsToMilliseconds(const float seconds) {
+		return (seconds <= 0.0f) ? 0 : uint32_t(std::lround(seconds * 1000.0f));
+	}
+
+	float MillisecondsToSeconds(const uint32_t milliseconds) {
+		return float(milliseconds) / 1000.0f;
+	}
+}
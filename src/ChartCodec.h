@@ -0,0 +1,37 @@
+#ifndef __CHART_CODEC__
+#define __CHART_CODEC__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+#include "constants/GameConstants.h"
+
+// Compressed level layout (all integers are LEB128 varints, times are in milliseconds) :
+//   magic (4 bytes) | version (1 byte)
+//   song name (length + bytes) | audio file name (length + bytes)
+//   length | lane length | notes count
+//   preview start + 1, 0 when not given (since version 2)
+//   per note, sorted by start time : (start delta << LANE_BITS) | column, duration
+namespace ChartCodec {
+	extern const char MAGIC[4];
+	const uint8_t VERSION = 2;
+	const uint8_t MIN_VERSION = 1; // Oldest version that can still be read
+	const unsigned int LANE_BITS = 2;
+	static_assert(GAME_LANE_COUNT <= (1 << LANE_BITS), "Lane index doesn't fit in compressed level lane bits");
+
+	bool HasMagic(const char* data, const size_t size);
+
+	// Writers expect valid values, callers check that columns fit in LANE_BITS and deltas in the rest
+	void WriteVarint(std::string &output, uint32_t value);
+	void WriteString(std::string &output, const std::string &value);
+
+	// Readers advance the cursor and return false when data is truncated or malformed
+	bool ReadVarint(const char* &cursor, const char* const end, uint32_t &value);
+	bool ReadString(const char* &cursor, const char* const end, std::string &value);
+
+	uint32_t SecondsToMilliseconds(const float seconds);
+	float MillisecondsToSeconds(const uint32_t milliseconds);
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include <windows.h>
+#include <timeapi.h>
+#include <algorithm>
+#include <cmath>
+
+#include "constants/InputConstants.h"
+#include "constants/SettingsConstants.h"
+#include "ChartRecorder.h"
+
+static bool LowestStartSeconds(const idMusicNote &left, const idMusicNote &right) {
+	return left.startSeconds < right.startSeconds;
+}
+
+static float Quantize(const float seconds, const float stepSeconds) {
+	return std::round(seconds / stepSeconds) * stepSeconds;
+}
+
+idChartRecorder::idChartRecorder()
+: shouldStop(false)
+, songTimeTicks(0)
+, songTimeSeconds(0.0f)
+, ticksPerSecond(1)
+, recordedNotes() {
+	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
+		pressSeconds[i] = 0.0f;
+		isLanePressed[i] = false;
+	}
+}
+
+idChartRecorder::~idChartRecorder() {
+	Stop();
+}
+
+void idChartRecorder::Start() {
+	Stop();
+
+	recordedNotes.clear();
+	capturedEvents.Clear();
+	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
+		isLanePressed[i] = false;
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&counter);
+	ticksPerSecond = counter.QuadPart;
+	QueryPerformanceCounter(&counter);
+	songTimeTicks = counter.QuadPart;
+	songTimeSeconds = 0.0f;
+
+	shouldStop = false;
+	captureThread = std::thread(&idChartRecorder::CaptureLoop, this);
+}
+
+void idChartRecorder::Stop() {
+	if (!captureThread.joinable()) {
+		return;
+	}
+
+	shouldStop = true;
+	captureThread.join();
+	CollectCapturedEvents();
+
+	// Notes of keys held when recording ends last until then
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	const float stopSeconds = TicksToSeconds(counter.QuadPart);
+	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
+		if (isLanePressed[i]) {
+			recordedNotes.emplace_back(i, pressSeconds[i], stopSeconds);
+			isLanePressed[i] = false;
+		}
+	}
+}
+
+void idChartRecorder::SetSongTime(const float songSeconds) {
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	songTimeTicks = counter.QuadPart;
+	songTimeSeconds = songSeconds;
+}
+
+void idChartRecorder::CaptureLoop() {
+	bool wasKeyDown[GAME_LANE_COUNT] = {};
+	LARGE_INTEGER counter;
+
+	// Default timer resolution would make each poll last about 15.6ms
+	timeBeginPeriod(1);
+	while (!shouldStop) {
+		QueryPerformanceCounter(&counter);
+		for (int i = 0; i < GAME_LANE_COUNT; ++i) {
+			const bool isKeyDown = (GetAsyncKeyState(KeyConstants::LANE_KEYS[i]) & 0x8000) != 0;
+			if (isKeyDown == wasKeyDown[i]) {
+				continue;
+			}
+
+			// If the queue is full, the change is pushed again on next poll
+			keyEvent_t event = { i, isKeyDown, counter.QuadPart };
+			if (capturedEvents.Push(event)) {
+				wasKeyDown[i] = isKeyDown;
+			}
+		}
+		Sleep(RecordingSettingsConstants::CAPTURE_POLL_INTERVAL_MS);
+	}
+	timeEndPeriod(1);
+}
+
+void idChartRecorder::CollectCapturedEvents() {
+	keyEvent_t event;
+	while (capturedEvents.Pop(event)) {
+		const float eventSeconds = TicksToSeconds(event.ticks);
+		if (event.isPress) {
+			pressSeconds[event.lane] = eventSeconds;
+			isLanePressed[event.lane] = true;
+		} else if (isLanePressed[event.lane]) {
+			// Each press/release pair becomes a note
+			recordedNotes.emplace_back(event.lane, pressSeconds[event.lane], eventSeconds);
+			isLanePressed[event.lane] = false;
+		}
+	}
+}
+
+std::vector<idMusicNote> idChartRecorder::GetRecordedNotes(const float quantizeStepSeconds) const {
+	const float minDuration = RecordingSettingsConstants::MIN_NOTE_DURATION_SECONDS;
+
+	std::vector<idMusicNote> notes(recordedNotes);
+	for (idMusicNote &note : notes) {
+		// Keys pressed before the song is heard are moved to its start
+		note.startSeconds = (std::max)(note.startSeconds, 0.0f);
+		note.endSeconds = (std::max)(note.endSeconds, 0.0f);
+		if (quantizeStepSeconds > 0.0f) {
+			note.startSeconds = Quantize(note.startSeconds, quantizeStepSeconds);
+			note.endSeconds = Quantize(note.endSeconds, quantizeStepSeconds);
+		}
+		if (note.endSeconds - note.startSeconds < minDuration) {
+			note.endSeconds = note.startSeconds + minDuration;
+		}
+	}
+	std::sort(notes.begin(), notes.end(), LowestStartSeconds);
+
+	return notes;
+}
+
+size_t idChartRecorder::GetRecordedNotesCount() const {
+	return recordedNotes.size();
+}
+
+float idChartRecorder::TicksToSeconds(const int64_t ticks) const {
+	return songTimeSeconds + float(double(ticks - songTimeTicks) / double(ticksPerSecond));
+}
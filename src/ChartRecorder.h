@@ -0,0 +1,57 @@
+#ifndef __CHART_RECORDER__
+#define __CHART_RECORDER__
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "constants/GameConstants.h"
+#include "MusicNote.h"
+#include "SpscQueue.h"
+
+// Records lane key presses into notes, key states are sampled on a dedicated capture thread
+class idChartRecorder {
+	public:
+		idChartRecorder();
+		~idChartRecorder();
+
+		void Start();
+		// Keys still held are released at the time of the call
+		void Stop();
+		// Anchors captured times to the song clock (called by the game thread, once per frame)
+		void SetSongTime(const float songSeconds);
+		// Turns captured events into notes (called by the game thread, once per frame)
+		void CollectCapturedEvents();
+		// Returns recorded notes, start/end times being snapped to the given step if not zero
+		std::vector<idMusicNote> GetRecordedNotes(const float quantizeStepSeconds) const;
+		size_t GetRecordedNotesCount() const;
+	private:
+		struct keyEvent_t {
+			int lane;
+			bool isPress;
+			int64_t ticks; // Performance counter value when the change was detected
+		};
+
+		static const size_t CAPTURE_QUEUE_SIZE = 1024;
+
+		std::thread captureThread;
+		std::atomic<bool> shouldStop;
+		idSpscQueue<keyEvent_t, CAPTURE_QUEUE_SIZE> capturedEvents;
+		int64_t songTimeTicks; // Performance counter value when the song clock was last set
+		float songTimeSeconds;
+		int64_t ticksPerSecond;
+
+		float pressSeconds[GAME_LANE_COUNT];
+		bool isLanePressed[GAME_LANE_COUNT];
+		std::vector<idMusicNote> recordedNotes;
+
+		void CaptureLoop();
+		// Converts a performance counter value to song time
+		float TicksToSeconds(const int64_t ticks) const;
+
+		idChartRecorder(const idChartRecorder &other) = delete;
+		idChartRecorder& operator=(const idChartRecorder &other) = delete;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+#include "ChartWatcher.h"
+
+idChartWatcher::idChartWatcher()
+: levelFilePath("")
+, watchedDirectory("")
+, watchedFileName("")
+, shouldStop(false)
+, hasReloadedLevel(false) {}
+
+idChartWatcher::~idChartWatcher() {
+	Stop();
+}
+
+bool idChartWatcher::Start(const std::string &_levelFilePath) {
+	Stop();
+
+	// Split path into watched directory and file name
+	const size_t separatorIndex = _levelFilePath.find_last_of("\\/");
+	if (separatorIndex == std::string::npos) {
+		watchedDirectory = ".";
+		watchedFileName = _levelFilePath;
+	} else {
+		watchedDirectory = _levelFilePath.substr(0, separatorIndex);
+		watchedFileName = _levelFilePath.substr(separatorIndex + 1);
+	}
+	if (watchedFileName.empty()) {
+		return false;
+	}
+	levelFilePath = _levelFilePath;
+
+	shouldStop = false;
+	hasReloadedLevel = false;
+	watchThread = std::thread(&idChartWatcher::WatchLoop, this);
+
+	return true;
+}
+
+void idChartWatcher::Stop() {
+	if (!watchThread.joinable()) {
+		return;
+	}
+
+	shouldStop = true;
+	watchThread.join();
+	hasReloadedLevel = false;
+}
+
+bool idChartWatcher::PollReloadedLevel(idGameLevel &reloadedLevel) {
+	// Cheap check done every frame, the lock is only taken when a new level is ready
+	if (!hasReloadedLevel) {
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(reloadedLevelMutex);
+	reloadedLevel = std::move(pendingLevel);
+	hasReloadedLevel = false;
+
+	return true;
+}
+
+void idChartWatcher::ReloadLevel() {
+	// A file that fails to parse (e.g. saved mid-edit) is ignored, the previous notes stay in play
+	idGameLevel reloadedLevel;
+	if (!reloadedLevel.LoadFile(levelFilePath)) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(reloadedLevelMutex);
+	pendingLevel = std::move(reloadedLevel);
+	hasReloadedLevel = true;
+}
+
+#ifdef _WIN32
+void idChartWatcher::WatchLoop() {
+	HANDLE directory = CreateFileA(
+		watchedDirectory.c_str(),
+		FILE_LIST_DIRECTORY,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL,
+		OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+		NULL);
+	if (directory == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	OVERLAPPED overlapped = {};
+	overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (overlapped.hEvent == NULL) {
+		CloseHandle(directory);
+		return;
+	}
+
+	DWORD notifyBuffer[1024]; // Notifications must be DWORD-aligned
+	DWORD bytesReturned = 0;
+	bool isReadPending = false;
+	while (!shouldStop) {
+		if (!isReadPending) {
+			if (!ReadDirectoryChangesW(directory, notifyBuffer, sizeof(notifyBuffer), FALSE,
+				FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, NULL, &overlapped, NULL)) {
+				break;
+			}
+			isReadPending = true;
+		}
+
+		// Wake up regularly to check if we should stop
+		if (WaitForSingleObject(overlapped.hEvent, STOP_CHECK_INTERVAL_MS) != WAIT_OBJECT_0) {
+			continue;
+		}
+		isReadPending = false;
+		if (!GetOverlappedResult(directory, &overlapped, &bytesReturned, FALSE)) {
+			break;
+		}
+
+		// No data means the notification buffer overflowed, reload to be safe
+		bool isLevelChanged = (bytesReturned == 0);
+		const BYTE* notifyData = reinterpret_cast<const BYTE*>(notifyBuffer);
+		while (!isLevelChanged && (bytesReturned > 0)) {
+			const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(notifyData);
+			char fileName[MAX_PATH];
+			int fileNameLength = WideCharToMultiByte(CP_UTF8, 0, info->FileName, int(info->FileNameLength / sizeof(WCHAR)),
+				fileName, MAX_PATH, NULL, NULL);
+			isLevelChanged = (watchedFileName.compare(0, std::string::npos, fileName, fileNameLength) == 0);
+
+			if (info->NextEntryOffset == 0) {
+				break;
+			}
+			notifyData += info->NextEntryOffset;
+		}
+
+		if (isLevelChanged) {
+			Sleep(RELOAD_DEBOUNCE_MS);
+			ReloadLevel();
+		}
+	}
+
+	if (isReadPending) {
+		CancelIoEx(directory, &overlapped);
+		GetOverlappedResult(directory, &overlapped, &bytesReturned, TRUE);
+	}
+	CloseHandle(overlapped.hEvent);
+	CloseHandle(directory);
+}
+#else
+void idChartWatcher::WatchLoop() {
+	int inotifyFd = inotify_init1(IN_NONBLOCK);
+	if (inotifyFd < 0) {
+		return;
+	}
+	if (inotify_add_watch(inotifyFd, watchedDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(inotifyFd);
+		return;
+	}
+
+	alignas(struct inotify_event) char eventBuffer[4096];
+	pollfd pollDescriptor = { inotifyFd, POLLIN, 0 };
+	while (!shouldStop) {
+		// Wake up regularly to check if we should stop
+		if (poll(&pollDescriptor, 1, STOP_CHECK_INTERVAL_MS) <= 0) {
+			continue;
+		}
+
+		bool isLevelChanged = false;
+		ssize_t bytesRead;
+		while ((bytesRead = read(inotifyFd, eventBuffer, sizeof(eventBuffer))) > 0) {
+			for (char* eventData = eventBuffer; eventData < eventBuffer + bytesRead; ) {
+				const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(eventData);
+				if ((event->len > 0) && (watchedFileName == event->name)) {
+					isLevelChanged = true;
+				}
+				eventData += sizeof(struct inotify_event) + event->len;
+			}
+		}
+
+		if (isLevelChanged) {
+			usleep(RELOAD_DEBOUNCE_MS * 1000);
+			ReloadLevel();
+		}
+	}
+
+	close(inotifyFd);
+}
+#endif
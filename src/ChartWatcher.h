@@ -0,0 +1,44 @@
+#ifndef __CHART_WATCHER__
+#define __CHART_WATCHER__
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include "GameLevel.h"
+
+// Watches a level file on disk and re-parses it on a background thread whenever it changes
+class idChartWatcher {
+	public:
+		idChartWatcher();
+		~idChartWatcher();
+
+		bool Start(const std::string &levelFilePath);
+		void Stop();
+		// Moves the latest re-parsed level into reloadedLevel (returns false if there is none)
+		bool PollReloadedLevel(idGameLevel &reloadedLevel);
+	private:
+		// Delay letting editors finish writing the file before it is parsed
+		static const unsigned int RELOAD_DEBOUNCE_MS = 50;
+		// Maximum time the watch thread waits before checking if it should stop
+		static const unsigned int STOP_CHECK_INTERVAL_MS = 100;
+
+		std::string levelFilePath;
+		std::string watchedDirectory;
+		std::string watchedFileName;
+
+		std::thread watchThread;
+		std::atomic<bool> shouldStop;
+		std::atomic<bool> hasReloadedLevel;
+		std::mutex reloadedLevelMutex;
+		idGameLevel pendingLevel;
+
+		void WatchLoop();
+		void ReloadLevel();
+
+		idChartWatcher(const idChartWatcher &other) = delete;
+		idChartWatcher& operator=(const idChartWatcher &other) = delete;
+};
+
+#endif
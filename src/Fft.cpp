@@ -0,0 +1,142 @@
+#include <cmath>
+
+#include "Fft.h"
+
+// SSE2 is always available on x86 and x64 Windows targets
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define FFT_SSE2
+#endif
+
+static const double PI = 3.14159265358979323846;
+
+idFft::idFft()
+: size(0)
+, window()
+, bitReversedIndices()
+, twiddleReals()
+, twiddleImags()
+, reals()
+, imags() {}
+
+bool idFft::Init(const size_t _size) {
+	if ((_size < 8) || ((_size & (_size - 1)) != 0) || (_size > UINT32_MAX)) {
+		return false;
+	}
+	size = _size;
+
+	window.resize(size);
+	for (size_t i = 0; i < size; ++i) {
+		window[i] = float(0.5 - 0.5 * std::cos(2.0 * PI * double(i) / double(size)));
+	}
+
+	unsigned int bitCount = 0;
+	while ((size_t(1) << bitCount) < size) {
+		++bitCount;
+	}
+	bitReversedIndices.resize(size);
+	for (size_t i = 0; i < size; ++i) {
+		uint32_t reversed = 0;
+		for (unsigned int bit = 0; bit < bitCount; ++bit) {
+			reversed |= uint32_t((i >> bit) & 1) << (bitCount - 1 - bit);
+		}
+		bitReversedIndices[i] = reversed;
+	}
+
+	twiddleReals.resize(size - 1);
+	twiddleImags.resize(size - 1);
+	for (size_t half = 1; half < size; half *= 2) {
+		for (size_t k = 0; k < half; ++k) {
+			const double angle = -PI * double(k) / double(half);
+			twiddleReals[half - 1 + k] = float(std::cos(angle));
+			twiddleImags[half - 1 + k] = float(std::sin(angle));
+		}
+	}
+
+	reals.resize(size);
+	imags.resize(size);
+	return true;
+}
+
+size_t idFft::GetSize() const {
+	return size;
+}
+
+size_t idFft::GetBinCount() const {
+	return size / 2 + 1;
+}
+
+void idFft::ComputeMagnitudes(const float* const samples, float* const magnitudes) {
+	// Samples are stored in bit reversed order, so butterflies then work in place
+	for (size_t i = 0; i < size; ++i) {
+		const uint32_t index = bitReversedIndices[i];
+		reals[index] = samples[i] * window[i];
+		imags[index] = 0.0f;
+	}
+
+	Transform();
+
+	for (size_t i = 0; i <= size / 2; ++i) {
+		magnitudes[i] = std::sqrt(reals[i] * reals[i] + imags[i] * imags[i]);
+	}
+}
+
+void idFft::Transform() {
+	float* const re = &reals[0];
+	float* const im = &imags[0];
+
+	// First stages combine blocks too small to fill SIMD registers
+	for (size_t half = 1; (half < 4) && (half < size); half *= 2) {
+		for (size_t blockStart = 0; blockStart < size; blockStart += half * 2) {
+			for (size_t k = 0; k < half; ++k) {
+				const size_t a = blockStart + k;
+				const size_t b = a + half;
+				const float wr = twiddleReals[half - 1 + k];
+				const float wi = twiddleImags[half - 1 + k];
+				const float tr = re[b] * wr - im[b] * wi;
+				const float ti = re[b] * wi + im[b] * wr;
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+
+	// Following ones process 4 butterflies at once
+	for (size_t half = 4; half < size; half *= 2) {
+		const float* const wrs = &twiddleReals[half - 1];
+		const float* const wis = &twiddleImags[half - 1];
+		for (size_t blockStart = 0; blockStart < size; blockStart += half * 2) {
+			float* const reA = re + blockStart;
+			float* const imA = im + blockStart;
+			float* const reB = reA + half;
+			float* const imB = imA + half;
+#ifdef FFT_SSE2
+			for (size_t k = 0; k < half; k += 4) {
+				const __m128 wr = _mm_loadu_ps(wrs + k);
+				const __m128 wi = _mm_loadu_ps(wis + k);
+				const __m128 br = _mm_loadu_ps(reB + k);
+				const __m128 bi = _mm_loadu_ps(imB + k);
+				const __m128 tr = _mm_sub_ps(_mm_mul_ps(br, wr), _mm_mul_ps(bi, wi));
+				const __m128 ti = _mm_add_ps(_mm_mul_ps(br, wi), _mm_mul_ps(bi, wr));
+				const __m128 ar = _mm_loadu_ps(reA + k);
+				const __m128 ai = _mm_loadu_ps(imA + k);
+				_mm_storeu_ps(reB + k, _mm_sub_ps(ar, tr));
+				_mm_storeu_ps(imB + k, _mm_sub_ps(ai, ti));
+				_mm_storeu_ps(reA + k, _mm_add_ps(ar, tr));
+				_mm_storeu_ps(imA + k, _mm_add_ps(ai, ti));
+			}
+#else
+			for (size_t k = 0; k < half; ++k) {
+				const float tr = reB[k] * wrs[k] - imB[k] * wis[k];
+				const float ti = reB[k] * wis[k] + imB[k] * wrs[k];
+				reB[k] = reA[k] - tr;
+				imB[k] = imA[k] - ti;
+				reA[k] += tr;
+				imA[k] += ti;
+			}
+#endif
+		}
+	}
+}
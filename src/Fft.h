@@ -0,0 +1,34 @@
+#ifndef __FFT__
+#define __FFT__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Radix-2 fast Fourier transform of blocks of real samples, with precomputed tables for one size.
+// Work buffers are kept between transforms, so each thread must use its own instance.
+class idFft {
+	public:
+		idFft();
+
+		// Size must be a power of two, at least 8
+		bool Init(const size_t _size);
+		size_t GetSize() const;
+		// Number of frequency bins of the spectrum (size / 2 + 1, from 0Hz to the Nyquist frequency)
+		size_t GetBinCount() const;
+		// Magnitudes of the spectrum of size samples, a Hann window being applied first
+		void ComputeMagnitudes(const float* const samples, float* const magnitudes);
+	private:
+		size_t size;
+		std::vector<float> window;
+		std::vector<uint32_t> bitReversedIndices;
+		// Twiddle factors of the stage combining blocks of n values start at index n - 1
+		std::vector<float> twiddleReals;
+		std::vector<float> twiddleImags;
+		std::vector<float> reals;
+		std::vector<float> imags;
+
+		void Transform();
+};
+
+#endif
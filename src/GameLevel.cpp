@@ -1,7 +1,11 @@
 #include <fstream>
+#include <sstream>
 #include <algorithm>
+#include <cctype>
 
 #include "constants/GameConstants.h"
+#include "ChartCodec.h"
+#include "HashUtils.h"
 #include "GameLevel.h"
 
 #define EXTRACT_LINE_WITH_FAIL_RETURN(istream, string) if (!std::getline(istream, string)) { return false; }
@@ -15,15 +19,89 @@ static bool LowestEndSeconds(const idMusicNote &left, const idMusicNote &right)
 	return left.endSeconds < right.endSeconds;
 }
 
+static void TrimCarriageReturn(std::string &line) {
+	if (!line.empty() && (line.back() == '\r')) {
+		line.pop_back();
+	}
+}
+
 idGameLevel::idGameLevel()
 : songName("")
 , audioFileName("")
 , lengthSeconds(0)
-, laneLengthSeconds(0) {}
+, laneLengthSeconds(0)
+, previewSeconds(-1.0f)
+, contentHash(0) {}
 
 bool idGameLevel::LoadFile(const std::string &levelFileName) {
-	std::ifstream levelFile(levelFileName);
+	return LoadFileData(levelFileName, false);
+}
+
+bool idGameLevel::LoadFileHeader(const std::string &levelFileName) {
+	return LoadFileData(levelFileName, true);
+}
+
+bool idGameLevel::HashFile(const std::string &levelFileName, uint64_t &hash) {
+	std::string levelData;
+	if (!ReadFileData(levelFileName, levelData)) {
+		return false;
+	}
+	hash = HashLevelData(levelData);
+	return true;
+}
+
+bool idGameLevel::ReadFileData(const std::string &levelFileName, std::string &levelData) {
+	// Read the whole file at once, its format is then detected from its first bytes
+	std::ifstream file(levelFileName, std::ios_base::binary | std::ios_base::ate);
+	if (!file.good() || !file.is_open()) {
+		return false;
+	}
+	levelData.assign(size_t(file.tellg()), '\0');
+	file.seekg(0);
+	return levelData.empty() || !file.read(&levelData[0], levelData.size()).fail();
+}
+
+uint64_t idGameLevel::HashLevelData(const std::string &levelData) {
+	if (ChartCodec::HasMagic(levelData.data(), levelData.size())) {
+		return HashData64(levelData.data(), levelData.size());
+	}
 
+	// Text levels are hashed with each blank run reduced to a single space, or to a single line break
+	// if it spans lines, so that saving a level with other line endings keeps its high scores
+	std::string normalizedData;
+	normalizedData.reserve(levelData.size());
+	size_t i = 0;
+	while (i < levelData.size()) {
+		if (!std::isspace(static_cast<unsigned char>(levelData[i]))) {
+			normalizedData.push_back(levelData[i++]);
+			continue;
+		}
+		bool hasLineBreak = false;
+		for (; (i < levelData.size()) && std::isspace(static_cast<unsigned char>(levelData[i])); ++i) {
+			hasLineBreak = hasLineBreak || (levelData[i] == '\n');
+		}
+		if (!normalizedData.empty() && (i < levelData.size())) {
+			normalizedData.push_back(hasLineBreak ? '\n' : ' ');
+		}
+	}
+	return HashData64(normalizedData.data(), normalizedData.size());
+}
+
+bool idGameLevel::LoadFileData(const std::string &levelFileName, const bool isHeaderOnly) {
+	std::string levelData;
+	if (!ReadFileData(levelFileName, levelData)) {
+		return false;
+	}
+	contentHash = HashLevelData(levelData);
+
+	if (ChartCodec::HasMagic(levelData.data(), levelData.size())) {
+		return LoadCompressedData(levelData, isHeaderOnly);
+	}
+	std::istringstream levelStream(levelData);
+	return LoadTextData(levelStream, isHeaderOnly);
+}
+
+bool idGameLevel::LoadTextData(std::istream &levelFile, const bool isHeaderOnly) {
 	// Load main level data
 	EXTRACT_LINE_WITH_FAIL_RETURN(levelFile, songName)
 	EXTRACT_LINE_WITH_FAIL_RETURN(levelFile, audioFileName)
@@ -31,12 +109,25 @@ bool idGameLevel::LoadFile(const std::string &levelFileName) {
 	EXTRACT_WITH_FAIL_RETURN(levelFile, laneLengthSeconds)
 	size_t notesCount;
 	EXTRACT_WITH_FAIL_RETURN(levelFile, notesCount)
+	// Preview start is optional, it ends the line of the notes count when it's given
+	previewSeconds = -1.0f;
+	if (!levelFile.eof()) {
+		std::string headerEnd;
+		std::getline(levelFile, headerEnd);
+		std::istringstream headerEndStream(headerEnd);
+		if (!(headerEndStream >> previewSeconds)) {
+			previewSeconds = -1.0f;
+		}
+	}
+	// The file is read in binary mode, remove carriage returns of Windows line endings
+	TrimCarriageReturn(songName);
+	TrimCarriageReturn(audioFileName);
 
 	// Clear previously loaded notes (if any)
-	unplayedNotes.clear();
-	playedNotes.clear();
-	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
-		activeNotes[i].clear();
+	ClearNotes();
+	allNotes.clear();
+	if (isHeaderOnly) {
+		return true;
 	}
 
 	// Load notes data
@@ -49,10 +140,158 @@ bool idGameLevel::LoadFile(const std::string &levelFileName) {
 	}
 	// Sort notes in descending order
 	std::sort(unplayedNotes.begin(), unplayedNotes.end(), HighestStartSeconds);
+	allNotes = unplayedNotes;
+
+	return !levelFile.fail();
+}
+
+bool idGameLevel::LoadCompressedData(const std::string &levelData, const bool isHeaderOnly) {
+	const char* cursor = levelData.data() + sizeof(ChartCodec::MAGIC);
+	const char* const end = levelData.data() + levelData.size();
+
+	if (cursor >= end) {
+		return false;
+	}
+	const uint8_t version = uint8_t(*cursor++);
+	if ((version < ChartCodec::MIN_VERSION) || (version > ChartCodec::VERSION)) {
+		return false;
+	}
+
+	// Load main level data
+	uint32_t lengthMilliseconds, laneLengthMilliseconds, notesCount;
+	if (!ChartCodec::ReadString(cursor, end, songName) ||
+		!ChartCodec::ReadString(cursor, end, audioFileName) ||
+		!ChartCodec::ReadVarint(cursor, end, lengthMilliseconds) ||
+		!ChartCodec::ReadVarint(cursor, end, laneLengthMilliseconds) ||
+		!ChartCodec::ReadVarint(cursor, end, notesCount)) {
+		return false;
+	}
+	lengthSeconds = ChartCodec::MillisecondsToSeconds(lengthMilliseconds);
+	laneLengthSeconds = ChartCodec::MillisecondsToSeconds(laneLengthMilliseconds);
+	uint32_t previewField = 0;
+	if ((version >= 2) && !ChartCodec::ReadVarint(cursor, end, previewField)) {
+		return false;
+	}
+	previewSeconds = (previewField > 0) ? ChartCodec::MillisecondsToSeconds(previewField - 1) : -1.0f;
+	if (isHeaderOnly) {
+		ClearNotes();
+		allNotes.clear();
+		return true;
+	}
+
+	// Each note takes at least two bytes, reject counts the data can't hold before allocating
+	if (notesCount > size_t(end - cursor) / 2) {
+		return false;
+	}
+
+	// Load notes data (stored in ascending order, decoded straight into descending order)
+	ClearNotes();
+	unplayedNotes.resize(notesCount);
+	const uint32_t laneMask = (1 << ChartCodec::LANE_BITS) - 1;
+	uint32_t startMilliseconds = 0;
+	uint32_t packedStart, durationMilliseconds;
+	for (size_t i = notesCount; i > 0; --i) {
+		if (!ChartCodec::ReadVarint(cursor, end, packedStart) ||
+			!ChartCodec::ReadVarint(cursor, end, durationMilliseconds)) {
+			return false;
+		}
+		startMilliseconds += packedStart >> ChartCodec::LANE_BITS;
+
+		idMusicNote &note = unplayedNotes[i - 1];
+		note.column = int(packedStart & laneMask);
+		note.startSeconds = ChartCodec::MillisecondsToSeconds(startMilliseconds);
+		note.endSeconds = ChartCodec::MillisecondsToSeconds(startMilliseconds + durationMilliseconds);
+		note.state = idMusicNote::state_t::ACTIVE;
+		if (note.column >= GAME_LANE_COUNT) {
+			return false;
+		}
+	}
+	allNotes = unplayedNotes;
+
+	return cursor == end;
+}
+
+bool idGameLevel::SaveCompressedFile(const std::string &levelFileName) const {
+	std::string levelData(ChartCodec::MAGIC, sizeof(ChartCodec::MAGIC));
+	levelData.push_back(char(ChartCodec::VERSION));
+
+	// Write main level data
+	ChartCodec::WriteString(levelData, songName);
+	ChartCodec::WriteString(levelData, audioFileName);
+	ChartCodec::WriteVarint(levelData, ChartCodec::SecondsToMilliseconds(lengthSeconds));
+	ChartCodec::WriteVarint(levelData, ChartCodec::SecondsToMilliseconds(laneLengthSeconds));
+	ChartCodec::WriteVarint(levelData, uint32_t(allNotes.size()));
+	ChartCodec::WriteVarint(levelData, (previewSeconds >= 0.0f) ? ChartCodec::SecondsToMilliseconds(previewSeconds) + 1 : 0);
+
+	// Write notes data (stored in descending order, written in ascending order)
+	uint32_t previousStartMilliseconds = 0;
+	for (std::vector<idMusicNote>::const_reverse_iterator i = allNotes.rbegin(); i != allNotes.rend(); ++i) {
+		const uint32_t startMilliseconds = ChartCodec::SecondsToMilliseconds(i->startSeconds);
+		const uint32_t endMilliseconds = ChartCodec::SecondsToMilliseconds(i->endSeconds);
+		const uint32_t durationMilliseconds = (endMilliseconds > startMilliseconds) ? endMilliseconds - startMilliseconds : 0;
+
+		// Rounding may reorder notes starting less than a millisecond apart, keep deltas positive
+		const uint32_t startDelta = (startMilliseconds > previousStartMilliseconds) ? startMilliseconds - previousStartMilliseconds : 0;
+		if ((i->column < 0) || (i->column >= GAME_LANE_COUNT) || (startDelta > (UINT32_MAX >> ChartCodec::LANE_BITS))) {
+			return false;
+		}
+		ChartCodec::WriteVarint(levelData, (startDelta << ChartCodec::LANE_BITS) | uint32_t(i->column));
+		ChartCodec::WriteVarint(levelData, durationMilliseconds);
+		previousStartMilliseconds += startDelta;
+	}
+
+	std::ofstream levelFile(levelFileName, std::ios_base::binary);
+	if (!levelFile.good() || !levelFile.is_open()) {
+		return false;
+	}
+	levelFile.write(levelData.data(), levelData.size());
+	levelFile.close(); // Close and flush the file to be able to check for errors
 
 	return !levelFile.fail();
 }
 
+bool idGameLevel::SaveFile(const std::string &levelFileName) const {
+	std::ofstream levelFile(levelFileName);
+	if (!levelFile.good() || !levelFile.is_open()) {
+		return false;
+	}
+
+	// Write main level data
+	levelFile << songName << "\n";
+	levelFile << audioFileName << "\n";
+	levelFile << lengthSeconds << " " << laneLengthSeconds << " " << allNotes.size();
+	if (previewSeconds >= 0.0f) {
+		levelFile << " " << previewSeconds;
+	}
+	levelFile << "\n\n";
+
+	// Write notes data (stored in descending order)
+	for (std::vector<idMusicNote>::const_reverse_iterator i = allNotes.rbegin(); i != allNotes.rend(); ++i) {
+		levelFile << i->column << " " << i->startSeconds << " " << i->endSeconds << "\n";
+	}
+	levelFile.close(); // Close and flush the file to be able to check for errors
+
+	return !levelFile.fail();
+}
+
+void idGameLevel::SetNotes(const std::vector<idMusicNote> &notes) {
+	ClearNotes();
+	unplayedNotes = notes;
+	std::sort(unplayedNotes.begin(), unplayedNotes.end(), HighestStartSeconds);
+	allNotes = unplayedNotes;
+}
+
+void idGameLevel::SetInfo(const std::string &_songName, const std::string &_audioFileName, const float _lengthSeconds, const float _laneLengthSeconds) {
+	songName = _songName;
+	audioFileName = _audioFileName;
+	lengthSeconds = _lengthSeconds;
+	laneLengthSeconds = _laneLengthSeconds;
+}
+
+void idGameLevel::SetPreviewSeconds(const float _previewSeconds) {
+	previewSeconds = _previewSeconds;
+}
+
 void idGameLevel::ActivateNotesForTime(const float time) {
 	if (unplayedNotes.size() > 0) {
 		idMusicNote nextNote = unplayedNotes.back();
@@ -89,6 +328,79 @@ void idGameLevel::RemoveNotesForTime(const float time, const float tolerance) {
 	}
 }
 
+void idGameLevel::ReplaceNotesAtTime(const idGameLevel &reloadedLevel, const float time) {
+	// Audio keeps playing, so only timing data is taken from the reloaded level
+	lengthSeconds = reloadedLevel.lengthSeconds;
+	laneLengthSeconds = reloadedLevel.laneLengthSeconds;
+	contentHash = reloadedLevel.contentHash;
+
+	// Upcoming notes are taken from the reloaded level, started ones keep their state (and take their new end)
+	// unless they were removed from it
+	std::vector<idMusicNote> startedNotes = GetStartedActiveNotes(time);
+	allNotes = reloadedLevel.allNotes;
+	RestoreNoteCursor(GetNoteCursorForTime(time), time);
+
+	std::vector<idMusicNote> keptNotes;
+	for (idMusicNote &note : startedNotes) {
+		// Notes are sorted in descending order of start time
+		std::vector<idMusicNote>::const_iterator reloadedNote = std::partition_point(
+			allNotes.begin(),
+			allNotes.end(),
+			[&note](const idMusicNote &other) { return other.startSeconds > note.startSeconds; });
+		for (; (reloadedNote != allNotes.end()) && (reloadedNote->startSeconds == note.startSeconds); ++reloadedNote) {
+			if (reloadedNote->column == note.column) {
+				note.endSeconds = reloadedNote->endSeconds;
+				keptNotes.push_back(note);
+				break;
+			}
+		}
+	}
+	RestoreStartedActiveNotes(keptNotes);
+}
+
+size_t idGameLevel::GetNoteCursorForTime(const float time) const {
+	// Notes are sorted in descending order, upcoming notes are at the front
+	std::vector<idMusicNote>::const_iterator firstPastNote = std::partition_point(
+		allNotes.begin(),
+		allNotes.end(),
+		[time](const idMusicNote &note) { return note.startSeconds >= time; });
+	return size_t(firstPastNote - allNotes.begin());
+}
+
+void idGameLevel::RestoreNoteCursor(const size_t noteCursor, const float time) {
+	ClearNotes();
+	unplayedNotes.assign(allNotes.begin(), allNotes.begin() + noteCursor);
+	ActivateNotesForTime(time);
+}
+
+std::vector<idMusicNote> idGameLevel::GetStartedActiveNotes(const float time) const {
+	std::vector<idMusicNote> notes;
+	for (int lane = 0; lane < GAME_LANE_COUNT; ++lane) {
+		for (const idMusicNote &note : activeNotes[lane]) {
+			if (note.startSeconds >= time) {
+				break; // Active notes of a lane are sorted by start time
+			}
+			notes.push_back(note);
+		}
+	}
+	return notes;
+}
+
+void idGameLevel::RestoreStartedActiveNotes(const std::vector<idMusicNote> &notes) {
+	// Notes of each lane are given in ascending order, the earliest one ends up at the front
+	for (std::vector<idMusicNote>::const_reverse_iterator i = notes.rbegin(); i != notes.rend(); ++i) {
+		activeNotes[i->column].push_front(*i);
+	}
+}
+
+void idGameLevel::ClearNotes() {
+	unplayedNotes.clear();
+	playedNotes.clear();
+	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
+		activeNotes[i].clear();
+	}
+}
+
 const std::deque<idMusicNote>& idGameLevel::GetReadonlyActiveNotes(const unsigned int lane) const {
 	return activeNotes[lane];
 }
@@ -120,3 +432,11 @@ const float& idGameLevel::GetLengthSeconds() const {
 const float& idGameLevel::GetLaneLengthSeconds() const {
 	return laneLengthSeconds;
 }
+
+const float& idGameLevel::GetPreviewSeconds() const {
+	return previewSeconds;
+}
+
+const uint64_t& idGameLevel::GetContentHash() const {
+	return contentHash;
+}
@@ -2,6 +2,7 @@
 #define __GAME_LEVEL__
 
 #include <string>
+#include <istream>
 #include <vector>
 #include <deque>
 
@@ -13,8 +14,29 @@ class idGameLevel {
 		idGameLevel();
 		
 		bool LoadFile(const std::string &levelFileName);
+		// Same as LoadFile, but notes aren't parsed (the level is left without notes)
+		bool LoadFileHeader(const std::string &levelFileName);
+		// Content hash of a level file without loading it, same as GetContentHash once it's loaded
+		static bool HashFile(const std::string &levelFileName, uint64_t &hash);
+		bool SaveFile(const std::string &levelFileName) const;
+		// Fails without writing anything when a note column doesn't fit in the compressed format
+		bool SaveCompressedFile(const std::string &levelFileName) const;
+		void SetNotes(const std::vector<idMusicNote> &notes);
+		void SetInfo(const std::string &_songName, const std::string &_audioFileName, const float _lengthSeconds, const float _laneLengthSeconds);
+		// Negative when the level doesn't give one
+		void SetPreviewSeconds(const float _previewSeconds);
 		void ActivateNotesForTime(const float time);
 		void RemoveNotesForTime(const float time, const float tolerance);
+		// Takes the notes of the reloaded level, notes being played stay active if they're still in it
+		void ReplaceNotesAtTime(const idGameLevel &reloadedLevel, const float time);
+		// Cursor counting the notes of the level starting at or after the given time
+		size_t GetNoteCursorForTime(const float time) const;
+		// Restarts the level at the given time, notes before the cursor being considered played
+		void RestoreNoteCursor(const size_t noteCursor, const float time);
+		// Active notes that started before the given time, with their state (they're before its cursor)
+		std::vector<idMusicNote> GetStartedActiveNotes(const float time) const;
+		// Makes notes active again after RestoreNoteCursor, they must have started before every active note
+		void RestoreStartedActiveNotes(const std::vector<idMusicNote> &notes);
 
 		const std::deque<idMusicNote>& GetReadonlyActiveNotes(const unsigned int lane) const;
 		const std::vector<idMusicNote>& GetPlayedNotes() const;
@@ -25,14 +47,28 @@ class idGameLevel {
 		const std::string& GetAudioFileName() const;
 		const float& GetLengthSeconds() const;
 		const float& GetLaneLengthSeconds() const;
+		// Time of the song played as a preview in the level selection
+		const float& GetPreviewSeconds() const;
+		// Identifies the level for high scores, spacing and line endings of text levels don't change it
+		const uint64_t& GetContentHash() const;
 	private:
 		std::string songName;
 		std::string audioFileName;
 		float lengthSeconds;
 		float laneLengthSeconds;
+		float previewSeconds;
+		uint64_t contentHash;
+		std::vector<idMusicNote> allNotes; // All notes of the level, in descending order
 		std::vector<idMusicNote> unplayedNotes;
 		std::deque<idMusicNote> activeNotes[GAME_LANE_COUNT];
 		std::vector<idMusicNote> playedNotes;
+
+		static bool ReadFileData(const std::string &levelFileName, std::string &levelData);
+		static uint64_t HashLevelData(const std::string &levelData);
+		bool LoadFileData(const std::string &levelFileName, const bool isHeaderOnly);
+		bool LoadTextData(std::istream &levelFile, const bool isHeaderOnly);
+		bool LoadCompressedData(const std::string &levelData, const bool isHeaderOnly);
+		void ClearNotes();
 };
 
 #endif
@@ -1,4 +1,6 @@
 #include <cmath>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 
 #include "constants/GameConstants.h"
@@ -15,19 +17,73 @@ idGameManager::idGameManager(idInputManager &_input, idViewManager &_view, idSou
 , sound(_sound)
 , score()
 , frameRate(_frameRate)
+, frameUpdateSeconds(0.0f)
+, isPerformanceOverlayShown(false)
 , timeSinceStepStart(0.0f)
 , currentLevelId(0)
+, isRecordQuantized(false)
+, playState(playState_t::PLAYING)
+, songTime(0.0f)
+, songTimeOffset(0.0f)
+, outputLatency(0.0f)
+, previousPlayUpdateTime(0.0f)
+, countdownStartTime(0.0f)
+, checkpointCount(0)
+, latestCheckpointIndex(0)
+, nextCheckpointTime(0.0f)
 , nextStep(gameStep_t::LEVEL_SELECT)
-, levelList()
-, selectedLevelIndex(0) {
+, songList()
+, selectedSongIndex(0)
+, selectedDifficultyIndex(0)
+, residentSongFilePath("")
+, residentSong()
+, residentSongLoad()
+, pendingSoundLoads()
+, isSelectionConfirmed(false)
+, isSelectedLevelLoaded(false)
+, selectionConfirmTime(0.0f)
+, menuNavigateSound()
+, menuConfirmSound()
+, comboBreakSound()
+, noteHitKeysound()
+, isNoteHitKeysoundLoaded(false)
+, assistTickKeysound()
+, isAssistTickKeysoundLoaded(false)
+, lastAssistTickTime(0.0f)
+, assistTickTimes()
+, menuBackSound() {
 	// Register keys used in program
 	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
 		input.RegisterKey(KeyConstants::LANE_KEYS[i]);
 	}
 	input.RegisterKey(KeyConstants::MENU_PREVIOUS);
 	input.RegisterKey(KeyConstants::MENU_NEXT);
+	input.RegisterKey(KeyConstants::MENU_DIFFICULTY_PREVIOUS);
+	input.RegisterKey(KeyConstants::MENU_DIFFICULTY_NEXT);
 	input.RegisterKey(KeyConstants::MENU_CONFIRM);
 	input.RegisterKey(KeyConstants::APPLICATION_EXIT);
+	input.RegisterKey(KeyConstants::MENU_RECORD);
+	input.RegisterKey(KeyConstants::RECORD_QUANTIZE);
+	input.RegisterKey(KeyConstants::PERFORMANCE_OVERLAY_TOGGLE);
+
+	// Unloaded songs stay cached, so going back to a previous one doesn't read it again
+	sound.SetCacheBudget(size_t(AudioSettingsConstants::SOUND_CACHE_BUDGET_MB) * 1024 * 1024);
+
+	// Sound effects are used through the whole session, they're loaded once and never unloaded
+	pendingSoundLoads.push_back(sound.LoadWavAsync(PathConstants::Audio::Effects::MENU_NAVIGATE, menuNavigateSound, soundPriority_t::LOW));
+	pendingSoundLoads.push_back(sound.LoadWavAsync(PathConstants::Audio::Effects::MENU_CONFIRM, menuConfirmSound));
+	pendingSoundLoads.push_back(sound.LoadWavAsync(PathConstants::Audio::Effects::MENU_BACK, menuBackSound));
+	pendingSoundLoads.push_back(sound.LoadWavAsync(PathConstants::Audio::Effects::COMBO_BREAK, comboBreakSound, soundPriority_t::CRITICAL));
+	// Keysounds are optional, levels are played without them when their file is missing
+	isNoteHitKeysoundLoaded = AudioSettingsConstants::KEYSOUNDS &&
+		LoadOptionalKeysound(PathConstants::Audio::Effects::NOTE_HIT, noteHitKeysound);
+	isAssistTickKeysoundLoaded = AudioSettingsConstants::ASSIST_TICKS &&
+		LoadOptionalKeysound(PathConstants::Audio::Effects::ASSIST_TICK, assistTickKeysound);
+	// Pinned so the cache never evicts them, even if a step unloads them (failed loads are reported by CheckSoundLoads)
+	const soundId_t effectSounds[] = { menuNavigateSound, menuConfirmSound, menuBackSound, comboBreakSound };
+	for (const soundId_t &effectSound : effectSounds) {
+		sound.SetPinned(effectSound, true);
+	}
 
 	// Load data about levels
 	if (!LoadLevelsData()) {
@@ -42,26 +98,107 @@ bool idGameManager::LoadLevelsData() {
 		return false;
 	}
 	
-	std::string levelFileName;
-	std::string levelDisplayName;
-	std::pair<std::string, std::string> levelListElement;
+	// Each line is "<level file>[,<level file>...] <display name>", one level file per difficulty
+	std::string levelFileNames;
+	std::string songDisplayName;
+	songInfo_t songListElement;
+	levelInfo_t level;
+	idGameLevel firstLevel;
 	while (!file.eof()) {
-		file >> levelFileName;
+		file >> levelFileNames;
 		if (file.fail()) {
-			break; // Fail at file name retrieval, we assume it's the end of file
+			break; // Fail at file names retrieval, we assume it's the end of file
 		}
 		file >> std::ws;
-		std::getline(file, levelDisplayName);
+		std::getline(file, songDisplayName);
 		if (file.fail()) {
 			return false; // Fail at display name retrieval, the file is invalid
 		}
-		levelListElement.first = levelFileName;
-		levelListElement.second = levelDisplayName;
-		levelList.push_back(levelListElement);
+
+		songListElement.displayName = songDisplayName;
+		songListElement.levels.clear();
+		size_t nameStart = 0;
+		while (nameStart <= levelFileNames.size()) {
+			size_t nameEnd = levelFileNames.find(',', nameStart);
+			if (nameEnd == std::string::npos) {
+				nameEnd = levelFileNames.size();
+			}
+			level.fileName = levelFileNames.substr(nameStart, nameEnd - nameStart);
+			// Song preview is described by the header of the first level, notes are only parsed once a level is played
+			if (songListElement.levels.empty()) {
+				if (!firstLevel.LoadFileHeader(PathConstants::GameData::LEVELS_DIR + level.fileName)) {
+					return false;
+				}
+				level.contentHash = firstLevel.GetContentHash();
+			} else if (!idGameLevel::HashFile(PathConstants::GameData::LEVELS_DIR + level.fileName, level.contentHash)) {
+				return false; // Level file can't be read
+			}
+			songListElement.levels.push_back(level);
+			nameStart = nameEnd + 1;
+		}
+
+		songListElement.audioFileName = firstLevel.GetAudioFileName();
+		songListElement.previewSeconds = firstLevel.GetPreviewSeconds();
+		if (songListElement.previewSeconds < 0.0f) {
+			songListElement.previewSeconds = firstLevel.GetLengthSeconds() * MenuSettingsConstants::DEFAULT_PREVIEW_START_RATIO;
+		}
+		songList.push_back(songListElement);
+	}
+	if (songList.empty() || (songList.size() > MAX_LEVEL_COUNT)) {
+		return false;
 	}
 
-	// Load high score list
+	// Load high score list (and move scores of older files from level file names to level hashes)
 	score.LoadHighScores(PathConstants::GameData::LEVEL_HIGH_SCORES);
+	for (const songInfo_t &song : songList) {
+		for (const levelInfo_t &songLevel : song.levels) {
+			score.MigrateLegacyHighScore(songLevel.fileName, songLevel.contentHash);
+		}
+	}
+
+	return true;
+}
+
+idGameManager::levelInfo_t& idGameManager::GetSelectedLevel() {
+	return songList[selectedSongIndex].levels[selectedDifficultyIndex];
+}
+
+bool idGameManager::MakeSongResident(const std::string &songFilePath) {
+	if (songFilePath == residentSongFilePath) {
+		return true;
+	}
+
+	// Take a reference on the new song before releasing the previous one
+	soundId_t songSound;
+	if (AudioSettingsConstants::SONG_STREAMING) {
+		if (!sound.LoadStream(songFilePath, songSound)) {
+			return false;
+		}
+		residentSongLoad = std::shared_future<soundLoadResult_t>();
+	} else {
+		residentSongLoad = sound.LoadWavAsync(songFilePath, songSound, soundPriority_t::CRITICAL);
+		pendingSoundLoads.push_back(residentSongLoad);
+	}
+	if (!residentSongFilePath.empty() && !sound.Unload(residentSong)) {
+		return false;
+	}
+	residentSongFilePath = songFilePath;
+	residentSong = songSound;
+
+	return true;
+}
+
+bool idGameManager::CheckSoundLoads() {
+	for (size_t i = pendingSoundLoads.size(); i-- > 0;) {
+		if (pendingSoundLoads[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			continue;
+		}
+		if (pendingSoundLoads[i].get() == soundLoadResult_t::FAILED) {
+			return false;
+		}
+		pendingSoundLoads[i] = pendingSoundLoads.back();
+		pendingSoundLoads.pop_back();
+	}
 
 	return true;
 }
@@ -81,6 +218,10 @@ int idGameManager::StartMainLoop() {
 				stepInitFunc = std::bind(&idGameManager::PlayLevelInit, this);
 				stepUpdateFunc = std::bind(&idGameManager::PlayLevelUpdate, this);
 				break;
+			case gameStep_t::LEVEL_RECORD:
+				stepInitFunc = std::bind(&idGameManager::RecordLevelInit, this);
+				stepUpdateFunc = std::bind(&idGameManager::RecordLevelUpdate, this);
+				break;
 			case gameStep_t::LEVEL_RESULTS:
 				stepInitFunc = std::bind(&idGameManager::LevelResultsInit, this);
 				stepUpdateFunc = std::bind(&idGameManager::LevelResultsUpdate, this);
@@ -123,6 +264,7 @@ void idGameManager::PlayGameStep(std::function<bool(void)> stepInitFunc, std::fu
 	// Prepare Update Loop
 	const float delayBetweenFrames = 1.0f / frameRate;
 	timeSinceStepStart = 0.0f;
+	stepUpdateTime = std::chrono::steady_clock::now();
 	bool shouldStop = stepUpdateFunc();
 
 	float startTime = timer.getElapsedSeconds();
@@ -136,9 +278,25 @@ void idGameManager::PlayGameStep(std::function<bool(void)> stepInitFunc, std::fu
 
 		if (currentLoopTime > (previousUpdateTime + delayBetweenFrames)) {
 			timeSinceStepStart = currentLoopTime - startTime;
+			stepUpdateTime = std::chrono::steady_clock::now();
+
+			if (input.WasKeyPressed(KeyConstants::PERFORMANCE_OVERLAY_TOGGLE)) {
+				isPerformanceOverlayShown = !isPerformanceOverlayShown;
+				if (!isPerformanceOverlayShown) {
+					view.ClearPerformanceOverlay();
+				}
+			}
 
 			shouldStop = stepUpdateFunc();
+			frameUpdateSeconds = timer.getElapsedSeconds() - currentLoopTime;
+			// Output rendered on a virtual clock follows the game clock, one frame at a time
+			sound.AdvanceClock(currentLoopTime - previousUpdateTime);
 			sound.UpdateSourceStates();
+			sound.UpdateLoads();
+			if (!CheckSoundLoads()) {
+				nextStep = gameStep_t::QUIT_ERROR;
+				shouldStop = true;
+			}
 			input.ResetKeyStates();
 
 			previousUpdateTime = currentLoopTime;
@@ -148,15 +306,7 @@ void idGameManager::PlayGameStep(std::function<bool(void)> stepInitFunc, std::fu
 }
 
 bool idGameManager::SelectLevelInit() {
-	// Load menu sound effects
-	if (!sound.LoadWav(PathConstants::Audio::Effects::MENU_NAVIGATE)) {
-		nextStep = gameStep_t::QUIT_ERROR;
-		return false;
-	}
-	if (!sound.LoadWav(PathConstants::Audio::Effects::MENU_CONFIRM)) {
-		nextStep = gameStep_t::QUIT_ERROR;
-		return false;
-	}
+	isSelectionConfirmed = false;
 
 	// Init UI
 	view.ClearConsole();
@@ -164,15 +314,18 @@ bool idGameManager::SelectLevelInit() {
 	view.DrawUIBorder();
 
 	std::string songNames[MAX_LEVEL_COUNT];
-	for (size_t i = 0; i < levelList.size(); i++){
-		songNames[i] = levelList[i].second;
+	for (size_t i = 0; i < songList.size(); i++){
+		songNames[i] = songList[i].displayName;
 	}
-	view.DrawSelectUI(songNames, levelList.size());
+	view.DrawSelectUI(songNames, songList.size());
 	view.UpdateSelectUI(
-		selectedLevelIndex,
-		score.GetHighScore(levelList[selectedLevelIndex].first)
+		selectedSongIndex,
+		score.GetHighScore(GetSelectedLevel().contentHash),
+		selectedDifficultyIndex,
+		songList[selectedSongIndex].levels.size()
 	);
 	view.Refresh();
+	PlaySelectedSongPreview();
 
 	return true;
 }
@@ -180,52 +333,88 @@ bool idGameManager::SelectLevelInit() {
 bool idGameManager::SelectLevelUpdate() {
 	// # Handle quitting the application
 	if (input.WasKeyPressed(KeyConstants::APPLICATION_EXIT)) {
+		sound.StopPreview();
 		view.ClearConsole();
 		view.Refresh();
 		nextStep = gameStep_t::QUIT_SUCCESS;
 		return true;
 	}
 
+	// # Wait for the confirmed level's song (the menu keeps running meanwhile)
+	if (isSelectionConfirmed) {
+		const bool isSongLoaded = !residentSongLoad.valid() ||
+			(residentSongLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+		return isSongLoaded && (timeSinceStepStart >= selectionConfirmTime + MenuSettingsConstants::CONFIRM_DISPLAY_SECONDS);
+	}
+
 	// # Menu navigation
-	const size_t levelCount = levelList.size();
+	const size_t songCount = songList.size();
 
 	bool selectionChanged = false;
+	bool songChanged = false;
 	if (input.WasKeyPressed(KeyConstants::MENU_NEXT)) {
-		selectedLevelIndex = (selectedLevelIndex + 1) % levelCount;
+		selectedSongIndex = (selectedSongIndex + 1) % songCount;
+		selectedDifficultyIndex = 0;
 		selectionChanged = true;
+		songChanged = true;
 	}
 	if (input.WasKeyPressed(KeyConstants::MENU_PREVIOUS)) {
-		selectedLevelIndex = (selectedLevelIndex + levelCount - 1) % levelCount;
+		selectedSongIndex = (selectedSongIndex + songCount - 1) % songCount;
+		selectedDifficultyIndex = 0;
+		selectionChanged = true;
+		songChanged = true;
+	}
+
+	const size_t difficultyCount = songList[selectedSongIndex].levels.size();
+	if (input.WasKeyPressed(KeyConstants::MENU_DIFFICULTY_NEXT) && (difficultyCount > 1)) {
+		selectedDifficultyIndex = (selectedDifficultyIndex + 1) % difficultyCount;
+		selectionChanged = true;
+	}
+	if (input.WasKeyPressed(KeyConstants::MENU_DIFFICULTY_PREVIOUS) && (difficultyCount > 1)) {
+		selectedDifficultyIndex = (selectedDifficultyIndex + difficultyCount - 1) % difficultyCount;
 		selectionChanged = true;
 	}
-	bool selectionConfirmed = input.WasKeyPressed(KeyConstants::MENU_CONFIRM);
+	bool recordConfirmed = input.WasKeyPressed(KeyConstants::MENU_RECORD);
+	bool selectionConfirmed = input.WasKeyPressed(KeyConstants::MENU_CONFIRM) || recordConfirmed;
 
 	// # Sound playing
 	if (selectionChanged) {
-		if (!sound.Play(PathConstants::Audio::Effects::MENU_NAVIGATE)) {
+		if (!sound.Play(menuNavigateSound)) {
 			nextStep = gameStep_t::QUIT_ERROR;
 			return true;
 		}
 	}
 	if (selectionConfirmed) {
-		if (!sound.Play(PathConstants::Audio::Effects::MENU_CONFIRM)) {
+		if (!sound.Play(menuConfirmSound)) {
 			nextStep = gameStep_t::QUIT_ERROR;
 			return true;
 		}
+		sound.StopPreview();
+	} else if (songChanged) {
+		// Previews are opened in the background, scrolling through the list never waits for them
+		PlaySelectedSongPreview();
 	}
 	
 	// # UI Display
 	if (selectionConfirmed) {
-		nextStep = gameStep_t::LEVEL_PLAY;
-		view.DrawConfirmedUI(selectedLevelIndex);
+		// Start loading the song while the confirmation is displayed
+		if (!LoadSelectedLevel()) {
+			nextStep = gameStep_t::QUIT_ERROR;
+			return true;
+		}
+		isSelectedLevelLoaded = true;
+		nextStep = recordConfirmed ? gameStep_t::LEVEL_RECORD : gameStep_t::LEVEL_PLAY;
+		isSelectionConfirmed = true;
+		selectionConfirmTime = timeSinceStepStart;
+		view.DrawConfirmedUI(selectedSongIndex);
 		view.Refresh();
-		Sleep(1000);
-		return true;
 	} else {
 		if (selectionChanged) {
 			view.UpdateSelectUI(
-				selectedLevelIndex,
-				score.GetHighScore(levelList[selectedLevelIndex].first)
+				selectedSongIndex,
+				score.GetHighScore(GetSelectedLevel().contentHash),
+				selectedDifficultyIndex,
+				difficultyCount
 			);
 			view.Refresh();
 		}
@@ -234,42 +423,80 @@ bool idGameManager::SelectLevelUpdate() {
 	return false;
 }
 
-bool idGameManager::PlayLevelInit() {
-	// Load sound effects
-	if (!sound.LoadWav(PathConstants::Audio::Effects::COMBO_BREAK)) {
-		nextStep = gameStep_t::QUIT_ERROR;
-		return false;
-	}
+void idGameManager::PlaySelectedSongPreview() {
+	const songInfo_t &song = songList[selectedSongIndex];
+	std::string songFilePath = PathConstants::Audio::SONGS_DIR;
+	songFilePath.append(song.audioFileName);
+
+	sound.PlayPreview(songFilePath, song.previewSeconds, MenuSettingsConstants::PREVIEW_DURATION_SECONDS);
+}
 
+bool idGameManager::LoadSelectedLevel() {
 	// Load level
 	std::string levelFileName = PathConstants::GameData::LEVELS_DIR;
-	levelFileName.append(levelList[selectedLevelIndex].first);
+	levelFileName.append(GetSelectedLevel().fileName);
 
 	if (!currentLevel.LoadFile(levelFileName)) {
-		nextStep = gameStep_t::QUIT_ERROR;
 		return false;
 	}
+	// Level may have been edited since the level list was loaded
+	GetSelectedLevel().contentHash = currentLevel.GetContentHash();
 
-	// Load level music data and play it
+	// Load level music data
 	std::string songFilePath = PathConstants::Audio::SONGS_DIR;
 	songFilePath.append(currentLevel.GetAudioFileName());
 
-	if (!sound.LoadWav(songFilePath)) {
-		nextStep = gameStep_t::QUIT_ERROR;
+	return MakeSongResident(songFilePath);
+}
+
+bool idGameManager::LoadSelectedLevelAndPlaySong() {
+	// Level parsed when the selection was confirmed is only used once, later plays parse it again
+	if (!isSelectedLevelLoaded && !LoadSelectedLevel()) {
 		return false;
 	}
+	isSelectedLevelLoaded = false;
+
+	return sound.Play(residentSong);
+}
 
-	if (!sound.Play(songFilePath)) {
+bool idGameManager::LoadOptionalKeysound(const std::string &fileName, soundId_t &soundId) {
+	if (sound.LoadKeysound(fileName, soundId)) {
+		return true;
+	}
+
+	const std::string message = "Keysound " + fileName + " can't be loaded, it won't be played\n";
+	OutputDebugStringA(message.c_str());
+	return false;
+}
+
+bool idGameManager::PlayLevelInit() {
+	// Load level and play its music
+	if (!LoadSelectedLevelAndPlaySong()) {
 		nextStep = gameStep_t::QUIT_ERROR;
 		return false;
 	}
 
-	// Reset score data
-	score.Reset();
-	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
-		latestLaneMistakes[i] = -2 * GameplaySettingsConstants::NOTE_ERROR_DISPLAY_DURATION;
+	// Reload level on the fly when it's edited
+	if (ChartAuthoringSettingsConstants::WATCH_PLAYED_LEVEL) {
+		std::string levelFileName = PathConstants::GameData::LEVELS_DIR;
+		levelFileName.append(GetSelectedLevel().fileName);
+		chartWatcher.Start(levelFileName);
+	}
+	if (AudioSettingsConstants::SPECTRUM_VISUALIZER) {
+		spectrum.Start(residentSongFilePath);
 	}
 
+	// Reset score and clock data
+	score.Reset();
+	ResetLaneMistakes();
+	playState = playState_t::PLAYING;
+	songTime = 0.0f;
+	LatchOutputLatency(); // Song clock starts late by the output latency
+	songTimeOffset = outputLatency;
+	previousPlayUpdateTime = 0.0f;
+	lastAssistTickTime = -1.0f;
+	ResetCheckpoints();
+
 	// Draw UI
 	const float songLength = currentLevel.GetLengthSeconds();
 	view.ClearUI();
@@ -279,12 +506,40 @@ bool idGameManager::PlayLevelInit() {
 }
 
 bool idGameManager::PlayLevelUpdate() {
-	if (!UpdateGameData() || !UpdateGameView()) {
+	// Song clock only moves forward while playing
+	if (playState != playState_t::PLAYING) {
+		songTimeOffset += timeSinceStepStart - previousPlayUpdateTime;
+	}
+	previousPlayUpdateTime = timeSinceStepStart;
+	songTime = timeSinceStepStart - songTimeOffset;
+
+	if (!UpdatePlayState()) {
 		nextStep = gameStep_t::QUIT_ERROR;
 		return true;
 	}
+	if (nextStep == gameStep_t::LEVEL_SELECT) {
+		return true; // Level was quit from the pause menu
+	}
 
-	if (timeSinceStepStart <= currentLevel.GetLengthSeconds()) {
+	if (playState == playState_t::PLAYING) {
+		if (songTime >= nextCheckpointTime) {
+			TakeCheckpoint();
+		}
+		if (isAssistTickKeysoundLoaded && !ScheduleAssistTicks()) {
+			nextStep = gameStep_t::QUIT_ERROR;
+			return true;
+		}
+		if (!UpdateGameData()) {
+			nextStep = gameStep_t::QUIT_ERROR;
+			return true;
+		}
+	}
+	if (!UpdateGameView()) {
+		nextStep = gameStep_t::QUIT_ERROR;
+		return true;
+	}
+
+	if (songTime <= currentLevel.GetLengthSeconds()) {
 		return false;
 	} else {
 		nextStep = gameStep_t::LEVEL_RESULTS;
@@ -292,9 +547,159 @@ bool idGameManager::PlayLevelUpdate() {
 	}
 }
 
+bool idGameManager::UpdatePlayState() {
+	switch (playState) {
+		case playState_t::PLAYING:
+			if (input.WasKeyPressed(KeyConstants::APPLICATION_EXIT)) {
+				playState = playState_t::PAUSED;
+				return sound.Pause(residentSong) && CancelAssistTicks();
+			}
+			break;
+		case playState_t::PAUSED:
+			if (input.WasKeyPressed(KeyConstants::MENU_CONFIRM)) {
+				playState = playState_t::COUNTDOWN;
+				countdownStartTime = timeSinceStepStart;
+			} else if (input.WasKeyPressed(KeyConstants::PAUSE_REWIND)) {
+				playState = playState_t::COUNTDOWN;
+				countdownStartTime = timeSinceStepStart;
+				return RewindToCheckpoint();
+			} else if (input.WasKeyPressed(KeyConstants::APPLICATION_EXIT)) {
+				chartWatcher.Stop();
+				spectrum.Stop();
+				nextStep = gameStep_t::LEVEL_SELECT;
+				return sound.Stop(residentSong);
+			}
+			break;
+		case playState_t::COUNTDOWN:
+			if (timeSinceStepStart - countdownStartTime >= PauseSettingsConstants::RESUME_COUNTDOWN_SECONDS) {
+				// Realign audio on the song clock before resuming (audio played now is only heard after the output latency)
+				playState = playState_t::PLAYING;
+				LatchOutputLatency();
+				if (!sound.HasVoice(residentSong)) {
+					// Its voice ended or was taken by another sound, the song is played again
+					return sound.Play(residentSong) && sound.SetPlaybackPosition(residentSong, songTime + outputLatency);
+				}
+				return sound.SetPlaybackPosition(residentSong, songTime + outputLatency) && sound.Resume(residentSong);
+			}
+			break;
+		default:
+			break;
+	}
+
+	return true;
+}
+
+void idGameManager::LatchOutputLatency() {
+	// Song clock follows what's heard rather than what's sent to the device
+	outputLatency = AudioSettingsConstants::OUTPUT_LATENCY_COMPENSATION ? sound.GetOutputLatency().deviceSeconds : 0.0f;
+}
+
+void idGameManager::ResetCheckpoints() {
+	checkpointCount = 0;
+	latestCheckpointIndex = 0;
+	nextCheckpointTime = songTime;
+}
+
+void idGameManager::TakeCheckpoint() {
+	latestCheckpointIndex = (latestCheckpointIndex + 1) % MAX_CHECKPOINT_COUNT;
+	if (checkpointCount < MAX_CHECKPOINT_COUNT) {
+		checkpointCount++;
+	}
+
+	// Notes starting before the checkpoint are considered played when rewinding, unless they're still active
+	checkpoint_t &checkpoint = checkpoints[latestCheckpointIndex];
+	checkpoint.songTime = songTime;
+	checkpoint.noteCursor = currentLevel.GetNoteCursorForTime(songTime);
+	checkpoint.startedNotes = currentLevel.GetStartedActiveNotes(songTime);
+	checkpoint.score = score.GetSnapshot();
+
+	nextCheckpointTime = songTime + PauseSettingsConstants::CHECKPOINT_INTERVAL_SECONDS;
+}
+
+bool idGameManager::RewindToCheckpoint() {
+	if (checkpointCount <= 0) {
+		return true;
+	}
+
+	// Drop checkpoints that are too recent to be worth rewinding to (the oldest one is always kept)
+	while ((checkpointCount > 1) &&
+		(checkpoints[latestCheckpointIndex].songTime > songTime - PauseSettingsConstants::MIN_REWIND_SECONDS)) {
+		latestCheckpointIndex = (latestCheckpointIndex + MAX_CHECKPOINT_COUNT - 1) % MAX_CHECKPOINT_COUNT;
+		checkpointCount--;
+	}
+
+	const checkpoint_t &checkpoint = checkpoints[latestCheckpointIndex];
+	score.RestoreSnapshot(checkpoint.score);
+	currentLevel.RestoreNoteCursor(checkpoint.noteCursor, checkpoint.songTime);
+	currentLevel.RestoreStartedActiveNotes(checkpoint.startedNotes);
+	ResetLaneMistakes();
+
+	songTimeOffset = timeSinceStepStart - checkpoint.songTime;
+	songTime = checkpoint.songTime;
+	nextCheckpointTime = songTime + PauseSettingsConstants::CHECKPOINT_INTERVAL_SECONDS;
+	lastAssistTickTime = songTime + outputLatency;
+
+	// A song without voice is played again from this position when the countdown ends
+	return !sound.HasVoice(residentSong) || sound.SetPlaybackPosition(residentSong, songTime + outputLatency);
+}
+
+bool idGameManager::ScheduleAssistTicks() {
+	// The song is played outputLatency ahead of the song clock, ticks are scheduled on the same timeline
+	const float playedSongTime = songTime + outputLatency;
+	const float scheduleEndTime = playedSongTime + AudioSettingsConstants::ASSIST_TICK_LOOKAHEAD_SECONDS;
+
+	// Chords get a single tick
+	assistTickTimes.clear();
+	for (unsigned int lane = 0; lane < GAME_LANE_COUNT; ++lane) {
+		for (const idMusicNote &note : currentLevel.GetReadonlyActiveNotes(lane)) {
+			if ((note.startSeconds > lastAssistTickTime) && (note.startSeconds <= scheduleEndTime)) {
+				assistTickTimes.push_back(note.startSeconds);
+			}
+		}
+	}
+	if (assistTickTimes.empty()) {
+		return true;
+	}
+	std::sort(assistTickTimes.begin(), assistTickTimes.end());
+	assistTickTimes.erase(std::unique(assistTickTimes.begin(), assistTickTimes.end()), assistTickTimes.end());
+
+	for (const float tickTime : assistTickTimes) {
+		const std::chrono::duration<float> delay(tickTime - playedSongTime);
+		if (!sound.PlayAt(assistTickKeysound, stepUpdateTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay))) {
+			return false;
+		}
+	}
+	lastAssistTickTime = assistTickTimes.back();
+	return true;
+}
+
+bool idGameManager::CancelAssistTicks() {
+	if (!isAssistTickKeysoundLoaded) {
+		return true;
+	}
+
+	// Ticks not played yet are scheduled again on resume
+	lastAssistTickTime = songTime + outputLatency;
+	return sound.Stop(assistTickKeysound);
+}
+
+void idGameManager::ResetLaneMistakes() {
+	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
+		latestLaneMistakes[i] = -2 * GameplaySettingsConstants::NOTE_ERROR_DISPLAY_DURATION;
+	}
+}
+
 bool idGameManager::UpdateGameData() {
+	// # Level Reloading
+	if (chartWatcher.PollReloadedLevel(reloadedLevel)) {
+		currentLevel.ReplaceNotesAtTime(reloadedLevel, songTime);
+		// Scores of the play are kept under the edited level
+		GetSelectedLevel().contentHash = currentLevel.GetContentHash();
+		ResetCheckpoints(); // Checkpoints point to notes of the previous version of the level
+	}
+
 	// # Input Management
-	currentLevel.ActivateNotesForTime(timeSinceStepStart);
+	currentLevel.ActivateNotesForTime(songTime);
 
 	const float pressEarlyTolerance = GameplaySettingsConstants::EARLY_PRESS_TOLERANCE_SECONDS;
 	const float pressLateTolerance = GameplaySettingsConstants::LATE_PRESS_TOLERANCE_SECONDS;
@@ -319,33 +724,37 @@ bool idGameManager::UpdateGameData() {
 		} while (
 			(bottomNoteIndex < laneNotesCount) &&
 			(bottomNote->state != idMusicNote::state_t::ACTIVE) && 
-			(timeSinceStepStart > bottomNote->endSeconds - releaseEarlyTolerance));
+			(songTime > bottomNote->endSeconds - releaseEarlyTolerance));
 
 		// Update note state
 		if (bottomNote->state != idMusicNote::state_t::MISSED) {
 			if (bottomNote->state == idMusicNote::state_t::ACTIVE) {
-				if (timeSinceStepStart > bottomNote->startSeconds + pressLateTolerance) {
+				if (songTime > bottomNote->startSeconds + pressLateTolerance) {
 					bottomNote->state = idMusicNote::state_t::MISSED;
 					isBigComboLoss |= RegisterMissOnLane(i);
 				} else if (input.WasKeyPressed(KeyConstants::LANE_KEYS[i])) {
-					if (timeSinceStepStart >= bottomNote->startSeconds - pressEarlyTolerance) {
+					if (songTime >= bottomNote->startSeconds - pressEarlyTolerance) {
 						bottomNote->state = idMusicNote::state_t::PRESSED;
+						// Mixer voices are cheap, so every hit gets its keysound
+						if (isNoteHitKeysoundLoaded) {
+							sound.Play(noteHitKeysound);
+						}
 					}
-					else if (timeSinceStepStart + maxMissTimeDistance >= bottomNote->startSeconds - pressEarlyTolerance) {
+					else if (songTime + maxMissTimeDistance >= bottomNote->startSeconds - pressEarlyTolerance) {
 						bottomNote->state = idMusicNote::state_t::MISSED;
 						isBigComboLoss |= RegisterMissOnLane(i);
 					}
 				}
 			} else if (bottomNote->state == idMusicNote::state_t::PRESSED) {
 				if (input.WasKeyReleased(KeyConstants::LANE_KEYS[i]) &&
-					(timeSinceStepStart <= bottomNote->endSeconds - releaseEarlyTolerance)) {
+					(songTime <= bottomNote->endSeconds - releaseEarlyTolerance)) {
 					bottomNote->state = idMusicNote::state_t::MISSED;
 					isBigComboLoss |= RegisterMissOnLane(i);
 				}
 			}
 		}
 	}
-	currentLevel.RemoveNotesForTime(timeSinceStepStart, pressLateTolerance);
+	currentLevel.RemoveNotesForTime(songTime, pressLateTolerance);
 
 	// # Score Management
 	const std::vector<idMusicNote> &playedNotes = currentLevel.GetPlayedNotes();
@@ -361,7 +770,7 @@ bool idGameManager::UpdateGameData() {
 	}
 	currentLevel.ClearPlayedNotes();
 	
-	if (isBigComboLoss && !sound.Play(PathConstants::Audio::Effects::COMBO_BREAK)) {
+	if (isBigComboLoss && !sound.Play(comboBreakSound)) {
 		return false;
 	}
 
@@ -372,7 +781,7 @@ bool idGameManager::RegisterMissOnLane(const int lane) {
 	const unsigned int comboCountBeforeNote = score.GetComboCount();
 
 	score.RegisterMiss();
-	latestLaneMistakes[lane] = timeSinceStepStart;
+	latestLaneMistakes[lane] = songTime;
 
 	return (comboCountBeforeNote >= GameplaySettingsConstants::BIG_COMBO_LOSS_THRESHOLD);
 }
@@ -385,7 +794,7 @@ bool idGameManager::UpdateGameView() {
 		const std::deque<idMusicNote> &laneNotes = currentLevel.GetReadonlyActiveNotes(lane);
 		for (int i = 0; i < laneNotes.size(); ++i) {
 			const idMusicNote &note = laneNotes[i];
-			view.DrawNote(note, laneLengthSeconds, timeSinceStepStart);
+			view.DrawNote(note, laneLengthSeconds, songTime);
 		}
 	}
 	
@@ -395,19 +804,56 @@ bool idGameManager::UpdateGameView() {
 	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
 		heldKeys[i] = input.WasKeyHeld(KeyConstants::LANE_KEYS[i]);
 		laneHasRecentMistake[i] = 
-			((timeSinceStepStart - latestLaneMistakes[i]) <= GameplaySettingsConstants::NOTE_ERROR_DISPLAY_DURATION);
+			((songTime - latestLaneMistakes[i]) <= GameplaySettingsConstants::NOTE_ERROR_DISPLAY_DURATION);
 	}
 	view.DrawBottomBar(heldKeys, laneHasRecentMistake);
 
+	// Draw spectrum, only redrawn when the analyzer published new bands
+	spectrum.SetPlaybackPosition(songTime);
+	uint8_t bandLevels[idSpectrumAnalyzer::BAND_COUNT];
+	if (spectrum.GetBandLevels(bandLevels)) {
+		view.DrawSpectrum(bandLevels, idSpectrumAnalyzer::BAND_COUNT, idSpectrumAnalyzer::MAX_LEVEL);
+	}
+
+	// Draw performance overlay
+	if (isPerformanceOverlayShown) {
+		const outputLatency_t &latency = sound.GetOutputLatency();
+		const voiceStats_t &voiceStats = sound.GetVoiceStats();
+		const cacheStats_t &cacheStats = sound.GetCacheStats();
+		const float bytesPerMegabyte = 1024.0f * 1024.0f;
+		view.DrawPerformanceOverlay(
+			frameUpdateSeconds * 1000.0f,
+			latency.deviceSeconds * 1000.0f,
+			latency.isMeasured,
+			latency.mixerSeconds * 1000.0f,
+			voiceStats.activeVoiceCount,
+			voiceStats.voiceCount,
+			float(cacheStats.cachedBytes) / bytesPerMegabyte,
+			float(cacheStats.bufferBytes) / bytesPerMegabyte,
+			float(cacheStats.budgetBytes) / bytesPerMegabyte,
+			cacheStats.hitCount,
+			cacheStats.hitCount + cacheStats.missCount,
+			cacheStats.evictionCount
+		);
+	}
+
+	// Draw pause overlay
+	if (playState == playState_t::PAUSED) {
+		view.DrawPauseMenu();
+	} else if (playState == playState_t::COUNTDOWN) {
+		const float countdownLeft = PauseSettingsConstants::RESUME_COUNTDOWN_SECONDS - (timeSinceStepStart - countdownStartTime);
+		view.DrawResumeCountdown(int(std::ceil(countdownLeft)));
+	}
+
 	// Draw UI
 	view.UpdateUI(
-		int(timeSinceStepStart),
+		int(songTime),
 		score.GetScore(),
 		score.GetComboCount(),
 		score.IsFullCombo(),
 		score.GetMissedNotesCount(),
-		score.GetHighScore(levelList[selectedLevelIndex].first),
-		score.IsHighScore(levelList[selectedLevelIndex].first)
+		score.GetHighScore(GetSelectedLevel().contentHash),
+		score.IsHighScore(GetSelectedLevel().contentHash)
 	);
 	
 	view.Refresh();
@@ -415,27 +861,85 @@ bool idGameManager::UpdateGameView() {
 	return true;
 }
 
-bool idGameManager::LevelResultsInit() {
-	// Unload level music
-	std::string audioFilePath = PathConstants::Audio::SONGS_DIR;
-	audioFilePath.append(currentLevel.GetAudioFileName());
-	if (!sound.UnloadFile(audioFilePath)) {
+bool idGameManager::RecordLevelInit() {
+	// Load level and play its music
+	if (!LoadSelectedLevelAndPlaySong()) {
 		nextStep = gameStep_t::QUIT_ERROR;
 		return false;
 	}
+	recorder.Start();
+	LatchOutputLatency();
+	songTimeOffset = outputLatency;
 
-	// Load sound effect
-	if (!sound.LoadWav(PathConstants::Audio::Effects::MENU_BACK)) {
-		nextStep = gameStep_t::QUIT_ERROR;
+	// Draw UI
+	view.ClearUI();
+	view.DrawRecordUI(currentLevel.GetSongName(), int(currentLevel.GetLengthSeconds()));
+
+	return true;
+}
+
+bool idGameManager::RecordLevelUpdate() {
+	// # Capture Management
+	// Keys are timed on the same clock as when playing, which follows what's heard rather than what's sent to the device
+	songTime = timeSinceStepStart - songTimeOffset;
+	recorder.SetSongTime(songTime);
+	recorder.CollectCapturedEvents();
+	if (input.WasKeyPressed(KeyConstants::RECORD_QUANTIZE)) {
+		isRecordQuantized = !isRecordQuantized;
+	}
+
+	// # UI Display
+	view.ClearNotesArea();
+	bool heldKeys[GAME_LANE_COUNT];
+	bool laneHasRecentMistake[GAME_LANE_COUNT];
+	for (int i = 0; i < GAME_LANE_COUNT; ++i) {
+		heldKeys[i] = input.WasKeyHeld(KeyConstants::LANE_KEYS[i]);
+		laneHasRecentMistake[i] = false;
+	}
+	view.DrawBottomBar(heldKeys, laneHasRecentMistake);
+	view.UpdateRecordUI(int(songTime), int(recorder.GetRecordedNotesCount()), isRecordQuantized);
+	view.Refresh();
+
+	if (songTime <= currentLevel.GetLengthSeconds()) {
 		return false;
 	}
 
+	// # Recorded Level Saving
+	recorder.Stop();
+	const float quantizeStep = isRecordQuantized ? RecordingSettingsConstants::QUANTIZE_STEP_SECONDS : 0.0f;
+	currentLevel.SetNotes(recorder.GetRecordedNotes(quantizeStep));
+
+	std::string recordedFileName = GetSelectedLevel().fileName;
+	recordedFileName = recordedFileName.substr(0, recordedFileName.find_last_of('.'));
+	std::string recordedFilePath = PathConstants::GameData::LEVELS_DIR;
+	if (RecordingSettingsConstants::SAVE_COMPRESSED_LEVELS) {
+		recordedFilePath.append(recordedFileName + PathConstants::GameData::COMPRESSED_RECORDED_LEVEL_SUFFIX);
+	} else {
+		recordedFilePath.append(recordedFileName + PathConstants::GameData::RECORDED_LEVEL_SUFFIX);
+	}
+
+	const bool isSaved = RecordingSettingsConstants::SAVE_COMPRESSED_LEVELS ?
+		currentLevel.SaveCompressedFile(recordedFilePath) :
+		currentLevel.SaveFile(recordedFilePath);
+	if (!isSaved) {
+		nextStep = gameStep_t::QUIT_ERROR;
+		return true;
+	}
+
+	nextStep = gameStep_t::LEVEL_SELECT;
+	return true;
+}
+
+bool idGameManager::LevelResultsInit() {
+	chartWatcher.Stop();
+	spectrum.Stop();
+
 	// Draw results
 	view.ClearNotesArea();
 	view.ClearUIBottom();
 	view.DrawResults(
 		score.GetScore(), 
-		score.IsHighScore(levelList[selectedLevelIndex].first), 
+		score.IsHighScore(GetSelectedLevel().contentHash), 
 		score.GetAccuracy(), 
 		score.GetPlayedNotesCount() - score.GetMissedNotesCount(),
 		score.GetPlayedNotesCount(),
@@ -444,8 +948,8 @@ bool idGameManager::LevelResultsInit() {
 	view.Refresh();
 
 	// Update high score file if needed
-	if (score.IsHighScore(levelList[selectedLevelIndex].first)) {
-		score.UpdateHighScore(levelList[selectedLevelIndex].first);
+	if (score.IsHighScore(GetSelectedLevel().contentHash)) {
+		score.UpdateHighScore(GetSelectedLevel().contentHash);
 		if (!score.SaveHighScores(PathConstants::GameData::LEVEL_HIGH_SCORES)) {
 			return false;
 		}
@@ -459,9 +963,14 @@ bool idGameManager::LevelResultsUpdate() {
 	view.Refresh();
 
 	// Check for input
+	if (input.WasKeyPressed(KeyConstants::RESULTS_RETRY)) {
+		// Song audio is still resident, the level restarts right away
+		nextStep = gameStep_t::LEVEL_PLAY;
+		return true;
+	}
 	if (input.WasKeyPressed(KeyConstants::MENU_CONFIRM)) {
 		// Play sound effect
-		if (!sound.Play(PathConstants::Audio::Effects::MENU_BACK)) {
+		if (!sound.Play(menuBackSound)) {
 			nextStep = gameStep_t::QUIT_ERROR;
 			return false;
 		}
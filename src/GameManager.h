@@ -1,9 +1,12 @@
 #ifndef __GAME_MANAGER__
 #define __GAME_MANAGER__
 
+#include <cstdint>
 #include <string>
 #include <functional>
 #include <vector>
+#include <future>
+#include <chrono>
 
 #include "constants/GameConstants.h"
 #include "NYTimer.h"
@@ -12,6 +15,9 @@
 #include "ViewManager.h"
 #include "SoundManager.h"
 #include "ScoreManager.h"
+#include "ChartWatcher.h"
+#include "ChartRecorder.h"
+#include "SpectrumAnalyzer.h"
 
 class idGameManager {
 	public:
@@ -22,40 +28,133 @@ class idGameManager {
 		enum class gameStep_t { 
 			LEVEL_SELECT, // Selecting a level to play
 			LEVEL_PLAY, // Playing a level (a song)
+			LEVEL_RECORD, // Recording a new level over a song
 			LEVEL_RESULTS, // Display results for played level
 			QUIT_SUCCESS, // Quitting the application (with success)
 			QUIT_ERROR // Quitting the application (with error)
 		};
 
+		// State of a level being played
+		enum class playState_t {
+			PLAYING, // Song and notes are running
+			PAUSED, // Song clock is frozen, waiting for the player
+			COUNTDOWN // Song clock is frozen, waiting for the resume countdown to end
+		};
+
+		// Lightweight state of a level, used to rewind it
+		struct checkpoint_t {
+			float songTime;
+			size_t noteCursor;
+			std::vector<idMusicNote> startedNotes; // Notes still active at the checkpoint (held notes for instance)
+			idScoreManager::snapshot_t score;
+		};
+
 		int currentLevelId;
 		idGameLevel currentLevel;
+		idGameLevel reloadedLevel;
+		idChartWatcher chartWatcher;
+		idChartRecorder recorder;
+		idSpectrumAnalyzer spectrum;
+		bool isRecordQuantized;
 		idInputManager &input;
 		idViewManager &view;
 		idSoundManager &sound;
 		idScoreManager score;
 		float latestLaneMistakes[GAME_LANE_COUNT];
 
-		std::vector<std::pair<std::string, std::string>> levelList;
-		size_t selectedLevelIndex;
+		playState_t playState;
+		float songTime; // Time in the played level, stops while paused
+		float songTimeOffset; // Time spent paused since the level started, plus the output latency when it started
+		// Delay before played audio is heard, the song clock is late by this much. It's only read when play
+		// starts or resumes, so that the song clock never jumps when the measure changes
+		float outputLatency;
+		float previousPlayUpdateTime;
+		float countdownStartTime;
+		// Ring buffer of checkpoints
+		checkpoint_t checkpoints[MAX_CHECKPOINT_COUNT];
+		size_t checkpointCount;
+		size_t latestCheckpointIndex;
+		float nextCheckpointTime;
+
+		struct levelInfo_t {
+			std::string fileName;
+			uint64_t contentHash; // Identifies the level for high scores
+		};
+
+		// Song with one level per difficulty (levels are expected to share the same audio file)
+		struct songInfo_t {
+			std::string displayName;
+			std::vector<levelInfo_t> levels;
+			std::string audioFileName; // Taken from the first level
+			float previewSeconds;
+		};
+
+		std::vector<songInfo_t> songList;
+		size_t selectedSongIndex;
+		size_t selectedDifficultyIndex;
+		// Song audio kept loaded while the player retries or switches between its difficulties
+		std::string residentSongFilePath;
+		soundId_t residentSong;
+		std::shared_future<soundLoadResult_t> residentSongLoad; // Not valid when the song is streamed
+		// Sounds loading in the background, a failed load stops the game (cancelled ones are only dropped)
+		std::vector<std::shared_future<soundLoadResult_t>> pendingSoundLoads;
+		// Selected level stays displayed as confirmed until its song is loaded
+		bool isSelectionConfirmed;
+		bool isSelectedLevelLoaded; // Current level was parsed on confirmation and hasn't been played yet
+		float selectionConfirmTime;
+		// Sound effects, handles are resolved once when they are loaded
+		soundId_t menuNavigateSound;
+		soundId_t menuConfirmSound;
+		soundId_t comboBreakSound;
+		soundId_t noteHitKeysound; // Played by the software mixer
+		bool isNoteHitKeysoundLoaded;
+		soundId_t assistTickKeysound; // Scheduled ahead on the mixer
+		bool isAssistTickKeysoundLoaded;
+		float lastAssistTickTime; // Song time of the latest scheduled tick
+		std::vector<float> assistTickTimes;
+		soundId_t menuBackSound;
 		gameStep_t nextStep;
 
 		NYTimer timer;
 		float timeSinceStepStart;
+		std::chrono::steady_clock::time_point stepUpdateTime; // Taken with timeSinceStepStart
 		const float frameRate;
+		float frameUpdateSeconds; // Time spent in the latest step update
+		bool isPerformanceOverlayShown;
 
 		void PlayGameStep(std::function<bool(void)> stepInitFunc, std::function<bool(void)> stepUpdateFunc);
 		bool LoadLevelsData();
+		levelInfo_t& GetSelectedLevel();
+		bool MakeSongResident(const std::string &songFilePath);
+		bool CheckSoundLoads();
 
 		bool SelectLevelInit();
 		bool SelectLevelUpdate();
+		void PlaySelectedSongPreview();
 		
+		bool LoadSelectedLevel();
+		bool LoadSelectedLevelAndPlaySong();
+
+		// Missing keysounds are reported to the debugger instead of stopping the game
+		bool LoadOptionalKeysound(const std::string &fileName, soundId_t &soundId);
 		bool PlayLevelInit();
 		bool PlayLevelUpdate();
+		bool UpdatePlayState();
+		void LatchOutputLatency();
+		void ResetCheckpoints();
+		void TakeCheckpoint();
+		bool RewindToCheckpoint();
+		void ResetLaneMistakes();
+		bool ScheduleAssistTicks();
+		bool CancelAssistTicks();
 		// Separate update into two functions for easier code management
 		bool UpdateGameData();
 		bool RegisterMissOnLane(const int lane);
 		bool UpdateGameView();
 
+		bool RecordLevelInit();
+		bool RecordLevelUpdate();
+
 		bool LevelResultsInit();
 		bool LevelResultsUpdate();
 };
@@ -0,0 +1,127 @@
+#include <cstring>
+
+#include "HashUtils.h"
+
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64_t RotateLeft(const uint64_t value, const int bits) {
+	return (value << bits) | (value >> (64 - bits));
+}
+
+// Assumes we're on a little-endian machine (such as on Windows)
+static inline uint64_t Read64(const uint8_t* data) {
+	uint64_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static inline uint32_t Read32(const uint8_t* data) {
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static inline uint64_t Round(uint64_t accumulator, const uint64_t input) {
+	accumulator += input * PRIME64_2;
+	accumulator = RotateLeft(accumulator, 31);
+	return accumulator * PRIME64_1;
+}
+
+static inline uint64_t MergeRound(uint64_t accumulator, const uint64_t value) {
+	accumulator ^= Round(0, value);
+	return accumulator * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t HashData64(const void* data, const size_t size, const uint64_t seed) {
+	const uint8_t* cursor = static_cast<const uint8_t*>(data);
+	const uint8_t* const end = cursor + size;
+	uint64_t hash;
+
+	// Process 32-byte stripes with four independent accumulators
+	if (size >= 32) {
+		uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+		uint64_t v2 = seed + PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - PRIME64_1;
+		const uint8_t* const lastStripe = end - 32;
+		do {
+			v1 = Round(v1, Read64(cursor));
+			v2 = Round(v2, Read64(cursor + 8));
+			v3 = Round(v3, Read64(cursor + 16));
+			v4 = Round(v4, Read64(cursor + 24));
+			cursor += 32;
+		} while (cursor <= lastStripe);
+
+		hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	} else {
+		hash = seed + PRIME64_5;
+	}
+	hash += uint64_t(size);
+
+	// Process remaining bytes
+	while (cursor + 8 <= end) {
+		hash ^= Round(0, Read64(cursor));
+		hash = RotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+		cursor += 8;
+	}
+	if (cursor + 4 <= end) {
+		hash ^= uint64_t(Read32(cursor)) * PRIME64_1;
+		hash = RotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+		cursor += 4;
+	}
+	while (cursor < end) {
+		hash ^= (*cursor) * PRIME64_5;
+		hash = RotateLeft(hash, 11) * PRIME64_1;
+		++cursor;
+	}
+
+	// Final avalanche
+	hash ^= hash >> 33;
+	hash *= PRIME64_2;
+	hash ^= hash >> 29;
+	hash *= PRIME64_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+std::string HashToString(const uint64_t hash) {
+	static const char HEX_DIGITS[] = "0123456789abcdef";
+
+	std::string res(16, '0');
+	for (int i = 15, shift = 0; i >= 0; --i, shift += 4) {
+		res[i] = HEX_DIGITS[(hash >> shift) & 0xF];
+	}
+	return res;
+}
+
+bool StringToHash(const std::string &hashString, uint64_t &hash) {
+	if (hashString.size() != 16) {
+		return false;
+	}
+
+	uint64_t res = 0;
+	for (const char c : hashString) {
+		res <<= 4;
+		if ((c >= '0') && (c <= '9')) {
+			res |= uint64_t(c - '0');
+		} else if ((c >= 'a') && (c <= 'f')) {
+			res |= uint64_t(c - 'a' + 10);
+		} else if ((c >= 'A') && (c <= 'F')) {
+			res |= uint64_t(c - 'A' + 10);
+		} else {
+			return false;
+		}
+	}
+
+	hash = res;
+	return true;
+}
@@ -0,0 +1,14 @@
+#ifndef __HASH_UTILS__
+#define __HASH_UTILS__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// 64-bit content hash (XXH64 algorithm : https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md)
+uint64_t HashData64(const void* data, const size_t size, const uint64_t seed = 0);
+
+std::string HashToString(const uint64_t hash);
+bool StringToHash(const std::string &hashString, uint64_t &hash);
+
+#endif
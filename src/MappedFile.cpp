@@ -0,0 +1,117 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+idMappedFile::idMappedFile()
+#ifdef _WIN32
+: fileHandle(INVALID_HANDLE_VALUE)
+, mappingHandle(NULL)
+#else
+: fileDescriptor(-1)
+#endif
+, data(nullptr)
+, size(0) {}
+
+idMappedFile::~idMappedFile() {
+	Close();
+}
+
+#ifdef _WIN32
+bool idMappedFile::Open(const std::string &fileName) {
+	Close();
+
+	fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) || (fileSize.QuadPart <= 0)) {
+		Close();
+		return false;
+	}
+	size = size_t(fileSize.QuadPart);
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL) {
+		Close();
+		return false;
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void idMappedFile::Close() {
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+	if (mappingHandle != NULL) {
+		CloseHandle(mappingHandle);
+		mappingHandle = NULL;
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		CloseHandle(fileHandle);
+		fileHandle = INVALID_HANDLE_VALUE;
+	}
+	size = 0;
+}
+#else
+bool idMappedFile::Open(const std::string &fileName) {
+	Close();
+
+	fileDescriptor = open(fileName.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		return false;
+	}
+
+	struct stat fileStatus;
+	if ((fstat(fileDescriptor, &fileStatus) != 0) || (fileStatus.st_size <= 0)) {
+		Close();
+		return false;
+	}
+	size = size_t(fileStatus.st_size);
+
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapping == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	data = static_cast<const char*>(mapping);
+
+	return true;
+}
+
+void idMappedFile::Close() {
+	if (data != nullptr) {
+		munmap(const_cast<char*>(data), size);
+		data = nullptr;
+	}
+	if (fileDescriptor >= 0) {
+		close(fileDescriptor);
+		fileDescriptor = -1;
+	}
+	size = 0;
+}
+#endif
+
+const char* idMappedFile::GetData() const {
+	return data;
+}
+
+size_t idMappedFile::GetSize() const {
+	return size;
+}
@@ -0,0 +1,31 @@
+#ifndef __MAPPED_FILE__
+#define __MAPPED_FILE__
+
+#include <cstddef>
+#include <string>
+
+// Read-only view of a whole file mapped in memory, pages are only read from disk when accessed
+class idMappedFile {
+	public:
+		idMappedFile();
+		~idMappedFile();
+
+		bool Open(const std::string &fileName);
+		void Close();
+		const char* GetData() const;
+		size_t GetSize() const;
+	private:
+#ifdef _WIN32
+		void* fileHandle;
+		void* mappingHandle;
+#else
+		int fileDescriptor;
+#endif
+		const char* data;
+		size_t size;
+
+		idMappedFile(const idMappedFile &other) = delete;
+		idMappedFile& operator=(const idMappedFile &other) = delete;
+};
+
+#endif
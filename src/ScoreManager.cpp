@@ -2,6 +2,7 @@
 #include <utility>
 
 #include "constants/SettingsConstants.h"
+#include "HashUtils.h"
 #include "ScoreManager.h"
 
 idScoreManager::idScoreManager()
@@ -10,7 +11,8 @@ idScoreManager::idScoreManager()
 , missedNotesCount(0)
 , playedNotesCount(0)
 , score(0)
-, levelHighScores() {}
+, levelHighScores()
+, legacyHighScores() {}
 
 bool idScoreManager::LoadHighScores(const std::string &fileName) {
 	std::ifstream file(fileName);
@@ -21,19 +23,25 @@ bool idScoreManager::LoadHighScores(const std::string &fileName) {
 		return true; // File is empty, do nothing
 	}
 
-	std::string levelFileName;
+	std::string levelKey;
+	uint64_t levelHash;
 	unsigned int levelHighScore = 0;
 	levelHighScores.clear();
+	legacyHighScores.clear();
 	while (!file.eof()) {
-		file >> levelFileName;
+		file >> levelKey;
 		if (file.fail()) {
-			return true; // Fail at file name retrieval, we assume it's the end of file
+			return true; // Fail at level key retrieval, we assume it's the end of file
 		}
 		file >> levelHighScore;
 		if (file.fail()) {
 			return false; // Fail at high score retrieval, the file is invalid
 		}
-		levelHighScores[levelFileName] = levelHighScore;
+		if (StringToHash(levelKey, levelHash)) {
+			levelHighScores[levelHash] = levelHighScore;
+		} else {
+			legacyHighScores[levelKey] = levelHighScore; // Older files are keyed by level file name
+		}
 	}
 
 	return true;
@@ -46,7 +54,10 @@ bool idScoreManager::SaveHighScores(const std::string &fileName) const {
 	}
 
 	// Write registered high scores into file
-	for (std::pair<const std::string, unsigned int> elem : levelHighScores) {
+	for (std::pair<const uint64_t, unsigned int> elem : levelHighScores) {
+		file << HashToString(elem.first) << " " << elem.second << "\n";
+	}
+	for (std::pair<const std::string, unsigned int> elem : legacyHighScores) {
 		file << elem.first << " " << elem.second << "\n";
 	}
 	file.close(); // Close and flush the file to be able to check for errors
@@ -80,21 +91,45 @@ void idScoreManager::RegisterMiss() {
 	playedNotesCount++;
 }
 
-const bool idScoreManager::IsHighScore(const std::string &levelFileName) const {
-	return (score > GetHighScore(levelFileName));
+void idScoreManager::MigrateLegacyHighScore(const std::string &levelFileName, const uint64_t levelHash) {
+	if (legacyHighScores.count(levelFileName) <= 0) {
+		return;
+	}
+
+	if (levelHighScores.count(levelHash) <= 0) {
+		levelHighScores[levelHash] = legacyHighScores.at(levelFileName);
+	}
+	legacyHighScores.erase(levelFileName);
+}
+
+idScoreManager::snapshot_t idScoreManager::GetSnapshot() const {
+	snapshot_t snapshot = { comboCount, maxComboCount, missedNotesCount, playedNotesCount, score };
+	return snapshot;
+}
+
+void idScoreManager::RestoreSnapshot(const snapshot_t &snapshot) {
+	comboCount = snapshot.comboCount;
+	maxComboCount = snapshot.maxComboCount;
+	missedNotesCount = snapshot.missedNotesCount;
+	playedNotesCount = snapshot.playedNotesCount;
+	score = snapshot.score;
+}
+
+const bool idScoreManager::IsHighScore(const uint64_t levelHash) const {
+	return (score > GetHighScore(levelHash));
 }
 
-const void idScoreManager::UpdateHighScore(const std::string &levelFileName) {
-	if (IsHighScore(levelFileName)) {
-		levelHighScores[levelFileName] = score;
+const void idScoreManager::UpdateHighScore(const uint64_t levelHash) {
+	if (IsHighScore(levelHash)) {
+		levelHighScores[levelHash] = score;
 	}
 }
 
-const unsigned int idScoreManager::GetHighScore(const std::string &levelFileName) const {
-	if (levelHighScores.count(levelFileName) <= 0) {
+const unsigned int idScoreManager::GetHighScore(const uint64_t levelHash) const {
+	if (levelHighScores.count(levelHash) <= 0) {
 		return 0;
 	} else {
-		return levelHighScores.at(levelFileName);
+		return levelHighScores.at(levelHash);
 	}
 }
 
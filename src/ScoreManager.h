@@ -1,6 +1,7 @@
 #ifndef __SCORE_MANAGER__
 #define __SCORE_MANAGER__
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -8,6 +9,15 @@
 
 class idScoreManager {
 	public:
+		// Score state of the current level, small enough to be copied at every checkpoint
+		struct snapshot_t {
+			unsigned int comboCount;
+			unsigned int maxComboCount;
+			unsigned int missedNotesCount;
+			unsigned int playedNotesCount;
+			unsigned int score;
+		};
+
 		idScoreManager();
 
 		bool LoadHighScores(const std::string &fileName);
@@ -15,10 +25,13 @@ class idScoreManager {
 		void Reset();
 		void RegisterHit(const float hitMultiplier);
 		void RegisterMiss();
-		const bool IsHighScore(const std::string &levelFileName) const;
-		const void UpdateHighScore(const std::string &levelFileName);
+		snapshot_t GetSnapshot() const;
+		void RestoreSnapshot(const snapshot_t &snapshot);
+		void MigrateLegacyHighScore(const std::string &levelFileName, const uint64_t levelHash);
+		const bool IsHighScore(const uint64_t levelHash) const;
+		const void UpdateHighScore(const uint64_t levelHash);
 		
-		const unsigned int GetHighScore(const std::string &levelFileName) const;
+		const unsigned int GetHighScore(const uint64_t levelHash) const;
 		const unsigned int GetComboCount() const;
 		const unsigned int GetMaxComboCount() const;
 		const unsigned int GetMissedNotesCount() const;
@@ -32,7 +45,10 @@ class idScoreManager {
 		unsigned int missedNotesCount;
 		unsigned int playedNotesCount;
 		unsigned int score;
-		std::unordered_map<std::string, unsigned int> levelHighScores;
+		// High scores are keyed by level content hash, so editing a level starts a new score table
+		std::unordered_map<uint64_t, unsigned int> levelHighScores;
+		// High scores from files keyed by level file name, waiting to be migrated
+		std::unordered_map<std::string, unsigned int> legacyHighScores;
 };
 
 #endif
@@ -1,37 +1,174 @@
 #include <utility>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
 
 #include "SoundUtils.h"
+#include "SoundResampler.h"
 #include "SoundManager.h"
 
-idSoundManager::idSoundManager() 
-: unplayingSources(INITIAL_SOURCE_COUNT, 0)
-, playingSources()
-, registeredBuffers() {
-	device = alcOpenDevice(NULL); // retrieve default device
-	context = alcCreateContext(device, NULL); // create context with no additional attributes
+const unsigned int idSoundManager::UPLOAD_TIME_BUDGET_MS;
+const size_t idSoundManager::DEFAULT_CACHE_BUDGET_BYTES;
+const size_t idSoundManager::SOURCE_EVENT_QUEUE_SIZE;
+const float idSoundManager::DEFAULT_DEVICE_LATENCY_SECONDS = 0.05f;
+const float idSoundManager::LATENCY_SMOOTHING = 0.1f;
+const char* const idSoundManager::BACKEND_VARIABLE = "ASCII_GAME_AUDIO_BACKEND";
+const char* const idSoundManager::SINK_FILE_VARIABLE = "ASCII_GAME_AUDIO_SINK_FILE";
+const char* const idSoundManager::CLOCK_VARIABLE = "ASCII_GAME_AUDIO_CLOCK";
+const char* const idSoundManager::DEFAULT_SINK_FILE_NAME = "audio_output.wav";
+
+// Returns false if the variable isn't set
+static bool GetEnvironmentString(const char* const name, std::string &value) {
+#ifdef _MSC_VER
+	char* buffer = nullptr;
+	size_t bufferSize = 0;
+	if ((_dupenv_s(&buffer, &bufferSize, name) != 0) || (buffer == nullptr)) {
+		return false;
+	}
+	value = buffer;
+	free(buffer);
+#else
+	const char* const buffer = std::getenv(name);
+	if (buffer == nullptr) {
+		return false;
+	}
+	value = buffer;
+#endif
+	return true;
+}
+
+idSoundManager::idSoundManager(const audioBackend_t requestedBackend, const std::string &sinkFileName)
+: backend(audioBackend_t::NONE)
+, sink()
+, stoppedSources()
+, hasLostSourceEvents(false)
+, unplayingSources()
+, playingVoices()
+, mixer()
+, preview()
+, nextPlayOrder(0)
+, voiceStats()
+, cacheStats()
+, nextUseOrder(0)
+, outputLatency()
+, sounds()
+, freeSoundIndices()
+, loadingSoundIndices()
+, soundIndices() {
+	OpenBackend(requestedBackend, sinkFileName);
 	alcMakeContextCurrent(context);
+	if ((backend == audioBackend_t::NULL_SINK) || (backend == audioBackend_t::FILE_SINK)) {
+		std::string clockName;
+		GetEnvironmentString(CLOCK_VARIABLE, clockName);
+		sink.Start((clockName == "virtual") ? sinkClock_t::VIRTUAL : sinkClock_t::SYSTEM);
+	}
+
+	// Buffers can use mapped files directly when static buffers are supported
+	bufferDataStatic = nullptr;
+	if (alIsExtensionPresent("AL_EXT_STATIC_BUFFER")) {
+		bufferDataStatic = reinterpret_cast<PFNALBUFFERDATASTATICPROC>(alGetProcAddress("alBufferDataStatic"));
+	}
+	// Otherwise asynchronous loads upload sound data in slices
+	bufferSubData = nullptr;
+	if (alIsExtensionPresent("AL_SOFT_buffer_sub_data")) {
+		bufferSubData = reinterpret_cast<PFNALBUFFERSUBDATASOFTPROC>(alGetProcAddress("alBufferSubDataSOFT"));
+	}
 	
-	// Prepare source pools
-	alGenSources(INITIAL_SOURCE_COUNT, &unplayingSources[0]);
-	for (int i = 0; i < INITIAL_SOURCE_COUNT; i++) {
-		InitSource(unplayingSources[i]);
+	// Samples wider than 16 bits keep their precision when float buffers are supported
+	isFloatSupported = (alIsExtensionPresent("AL_EXT_FLOAT32") == AL_TRUE);
+	isDithered = true;
+	cacheStats.budgetBytes = DEFAULT_CACHE_BUDGET_BYTES;
+
+	// Sounds are converted to the device rate when loaded, rather than resampled by the driver while playing
+	ALCint deviceFrequency = 0;
+	alcGetIntegerv(device, ALC_FREQUENCY, 1, &deviceFrequency);
+	outputSampleRate = (alcGetError(device) == ALC_NO_ERROR) ? int32_t(deviceFrequency) : 0;
+
+	// Output latency is read from the device clock or from sources when the driver supports it
+	getDeviceInteger64 = nullptr;
+	if (alcIsExtensionPresent(device, "ALC_SOFT_device_clock")) {
+		getDeviceInteger64 = reinterpret_cast<LPALCGETINTEGER64VSOFT>(alcGetProcAddress(device, "alcGetInteger64vSOFT"));
+	}
+	getSourceDoubles = nullptr;
+	if (alIsExtensionPresent("AL_SOFT_source_latency")) {
+		getSourceDoubles = reinterpret_cast<LPALGETSOURCEDVSOFT>(alGetProcAddress("alGetSourcedvSOFT"));
+	}
+	// Ended voices are reported by the driver when it supports source events, otherwise their end is predicted
+	eventCallback = nullptr;
+	if (alIsExtensionPresent("AL_SOFT_events")) {
+		LPALEVENTCONTROLSOFT eventControl = reinterpret_cast<LPALEVENTCONTROLSOFT>(alGetProcAddress("alEventControlSOFT"));
+		eventCallback = reinterpret_cast<LPALEVENTCALLBACKSOFT>(alGetProcAddress("alEventCallbackSOFT"));
+		if ((eventControl != nullptr) && (eventCallback != nullptr)) {
+			const ALenum eventType = AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT;
+			eventCallback(&idSoundManager::OnSourceEvent, this);
+			eventControl(1, &eventType, AL_TRUE);
+		} else {
+			eventCallback = nullptr;
+		}
+	}
+	voiceStats.isEventDriven = (eventCallback != nullptr);
+
+	// Otherwise it's estimated from the time between two device updates
+	ALCint refreshRate = 0;
+	alcGetIntegerv(device, ALC_REFRESH, 1, &refreshRate);
+	estimatedDeviceLatency = (refreshRate > 0) ? (float(ESTIMATED_DEVICE_UPDATE_COUNT) / float(refreshRate)) : DEFAULT_DEVICE_LATENCY_SECONDS;
+	outputLatency.deviceSeconds = estimatedDeviceLatency;
+
+	// Prepare voice pool, it never grows afterwards (it's smaller if the driver runs out of sources)
+	unplayingSources.reserve(MAX_VOICE_COUNT);
+	for (uint32_t i = 0; i < MAX_VOICE_COUNT; i++) {
+		ALuint newSource;
+		alGenSources(1, &newSource);
+		if (alGetError() != AL_NO_ERROR) {
+			break;
+		}
+		InitSource(newSource);
+		unplayingSources.push_back(newSource);
 	}
-	playingSources.reserve(INITIAL_SOURCE_COUNT);
+	playingVoices.reserve(unplayingSources.size());
+	voiceStats.voiceCount = (unsigned int)unplayingSources.size();
+
+	// Keysounds are mixed in software and played through the mixer's own source
+	// Sources are fed before each rendered block rather than by threads when output follows a virtual clock
+	mixer.Start(int32_t(refreshRate), sink.GetClock() != sinkClock_t::VIRTUAL);
+	preview.Start(outputSampleRate);
 }
 
 idSoundManager::~idSoundManager() {
+	if (eventCallback != nullptr) {
+		eventCallback(nullptr, nullptr);
+	}
+	mixer.Stop();
+	preview.Stop();
+
+	for (sound_t &sound : sounds) {
+		// Streams own their sources and must be closed while the context exists
+		sound.stream.reset();
+
+		// Wait for loading threads before dropping their loads
+		if (sound.pendingLoad) {
+			sound.pendingLoad->preparation.wait();
+			sound.pendingLoad->completion.set_value(soundLoadResult_t::CANCELLED);
+			sound.pendingLoad.reset();
+		}
+	}
+
 	if (unplayingSources.size() > 0) {
 		alDeleteSources((ALsizei)unplayingSources.size(), &unplayingSources[0]);
 	}
 
-	if (playingSources.size() > 0) {
-		alDeleteSources((ALsizei)playingSources.size(), &playingSources[0]);
+	for (const voice_t &voice : playingVoices) {
+		alDeleteSources(1, &voice.source);
 	}
 
-	for (std::pair<const std::string, ALuint> &p : registeredBuffers) {
-		alDeleteBuffers(1, &p.second);
+	for (sound_t &sound : sounds) {
+		if (sound.buffer != 0) {
+			alDeleteBuffers(1, &sound.buffer);
+		}
 	}
 
+	// Rendering must end before the context is destroyed
+	sink.Stop();
 	alcMakeContextCurrent(NULL);
 
 	if (context != NULL) {
@@ -43,138 +180,965 @@ idSoundManager::~idSoundManager() {
 	}
 }
 
-bool idSoundManager::LoadWav(const std::string &fileName) {
-	// Simply return if file already loaded
-	if (registeredBuffers.count(fileName) > 0) {
-		return true;
+void idSoundManager::OpenBackend(const audioBackend_t requestedBackend, const std::string &sinkFileName) {
+	backend = requestedBackend;
+	std::string fileName = sinkFileName;
+	if (backend == audioBackend_t::AUTOMATIC) {
+		std::string backendName;
+		GetEnvironmentString(BACKEND_VARIABLE, backendName);
+		if (backendName == "null") {
+			backend = audioBackend_t::NULL_SINK;
+		} else if (backendName == "file") {
+			backend = audioBackend_t::FILE_SINK;
+		} else {
+			backend = audioBackend_t::DEVICE;
+		}
+	}
+	if ((backend == audioBackend_t::FILE_SINK) && fileName.empty() && !GetEnvironmentString(SINK_FILE_VARIABLE, fileName)) {
+		fileName = DEFAULT_SINK_FILE_NAME;
 	}
 
-	// Prepare OpenAL buffer for sound data
-	ALuint newBuffer;
-	alGenBuffers(1, &newBuffer);
-	ALenum alError = alGetError();
-	if (alError != AL_NO_ERROR) {
-		return false;
+	device = NULL;
+	context = NULL;
+	if (backend == audioBackend_t::DEVICE) {
+		device = alcOpenDevice(NULL); // retrieve default device
+		if (device != NULL) {
+			context = alcCreateContext(device, NULL); // create context with no additional attributes
+		}
+		if (context != NULL) {
+			return;
+		}
+		// Machines without sound hardware still get a clock driven output
+		if (device != NULL) {
+			alcCloseDevice(device);
+			device = NULL;
+		}
+		backend = audioBackend_t::NULL_SINK;
 	}
-	
-	// Load sound data
-	int32_t numChannels, sampleRate, bitsPerSample, dataSize;
-	char* soundData = LoadWavFile(fileName, numChannels, sampleRate, bitsPerSample, dataSize);
-	if (soundData == nullptr) {
-		alDeleteBuffers(1, &newBuffer);
+
+	// A file that can't be written falls back to the null sink as well
+	if ((backend == audioBackend_t::FILE_SINK) && sink.Open(fileName)) {
+		device = sink.GetDevice();
+		context = alcCreateContext(device, sink.GetContextAttributes());
+		if (context != NULL) {
+			return;
+		}
+		sink.Stop();
+		alcCloseDevice(device);
+		device = NULL;
+	}
+
+	backend = audioBackend_t::NULL_SINK;
+	if (sink.Open("")) {
+		device = sink.GetDevice();
+		context = alcCreateContext(device, sink.GetContextAttributes());
+		if (context != NULL) {
+			return;
+		}
+		sink.Stop();
+		alcCloseDevice(device);
+		device = NULL;
+	}
+	backend = audioBackend_t::NONE;
+}
+
+bool idSoundManager::LoadWav(const std::string &fileName, soundId_t &soundId, const soundPriority_t priority) {
+	std::shared_future<soundLoadResult_t> load = LoadWavAsync(fileName, soundId, priority);
+
+	// Wait for the file to be read and upload it at once
+	sound_t* sound = GetSound(soundId);
+	if ((sound != nullptr) && sound->pendingLoad) {
+		sound->pendingLoad->preparation.wait();
+		FinishLoad(soundId.index, ContinueLoad(*sound, std::chrono::steady_clock::time_point::max()));
+	}
+
+	return load.get() == soundLoadResult_t::LOADED;
+}
+
+// Splits the conversion of long sounds between threads, on block boundaries so each part can be decoded on its own
+static bool ConvertWavDataInParallel(
+	const wavFormat_t &format,
+	const char* const data,
+	const size_t dataSize,
+	char* const destination,
+	const sampleType_t bufferSampleType,
+	const bool isDithered) {
+	static const size_t MIN_PART_SIZE = 1024 * 1024;
+
+	const size_t blockSize = size_t(format.blockAlign);
+	const size_t blockCount = (dataSize + blockSize - 1) / blockSize;
+	size_t partCount = (std::min)(size_t(std::thread::hardware_concurrency()), dataSize / MIN_PART_SIZE);
+	partCount = (std::max)(size_t(1), (std::min)(partCount, blockCount));
+	const size_t partBlockCount = (blockCount + partCount - 1) / partCount;
+
+	std::vector<std::future<bool>> parts;
+	for (size_t partStart = 0; partStart < dataSize; partStart += partBlockCount * blockSize) {
+		const size_t partSize = (std::min)(partBlockCount * blockSize, dataSize - partStart);
+		char* const partDestination = destination + GetConvertedWavDataSize(format, bufferSampleType, partStart);
+		const uint32_t seed = uint32_t(parts.size());
+		parts.push_back(std::async(std::launch::async, [=]() {
+			ditherState_t ditherState;
+			InitDitherState(ditherState, seed);
+			return ConvertWavData(format, data + partStart, partSize, partDestination, bufferSampleType, isDithered ? &ditherState : nullptr);
+		}));
+	}
+
+	bool isConverted = true;
+	for (std::future<bool> &part : parts) {
+		isConverted = part.get() && isConverted;
+	}
+	return isConverted;
+}
+
+bool idSoundManager::PrepareSound(const std::string fileName, const bool isFloatSupported, const bool isDithered, const int32_t outputSampleRate, preparedSound_t &prepared) {
+	static const size_t PAGE_SIZE = 4096;
+
+	sampleType_t sampleType, bufferSampleType;
+	prepared.mappedFile.reset(new idMappedFile());
+	if (!prepared.mappedFile->Open(fileName) ||
+		!ParseWavFile(prepared.mappedFile->GetData(), prepared.mappedFile->GetSize(), prepared.format, prepared.soundData, prepared.soundDataSize) ||
+		!GetWavBufferFormat(prepared.format, isFloatSupported, prepared.bufferFormat, bufferSampleType) ||
+		!GetWavSampleType(prepared.format, sampleType)) {
 		return false;
 	}
+	prepared.bufferBlockAlign = uint32_t(prepared.format.blockAlign);
 
-	// Compute format
-	ALenum format;
-	if (numChannels == 1) {
-		if (bitsPerSample == 8) {
-			format = AL_FORMAT_MONO8;
-		} else if (bitsPerSample == 16) {
-			format = AL_FORMAT_MONO16;
-		} else {
-			alDeleteBuffers(1, &newBuffer);
+	// Converted or decoded samples replace the mapping, which isn't needed anymore
+	if (bufferSampleType != sampleType) {
+		prepared.convertedData.resize(GetConvertedWavDataSize(prepared.format, bufferSampleType, prepared.soundDataSize));
+		if (prepared.convertedData.empty() ||
+			!ConvertWavDataInParallel(prepared.format, prepared.soundData, prepared.soundDataSize, &prepared.convertedData[0], bufferSampleType, isDithered)) {
 			return false;
 		}
-	} else if (numChannels == 2) {
-		if (bitsPerSample == 8) {
-			format = AL_FORMAT_STEREO8;
+		prepared.bufferBlockAlign = uint32_t(prepared.format.numChannels) * uint32_t(GetSampleTypeSize(bufferSampleType));
+		// Padding decoded at the end of the last compressed block isn't played
+		prepared.convertedData.resize(GetWavFrameCount(prepared.format, prepared.soundDataSize) * prepared.bufferBlockAlign);
+		prepared.soundData = &prepared.convertedData[0];
+		prepared.soundDataSize = uint32_t(prepared.convertedData.size());
+		prepared.mappedFile.reset();
+	}
+
+	// Resampled samples are 16-bit ones unless the buffer holds floats (rates that can't be converted are left to the driver)
+	if ((outputSampleRate > 0) && (prepared.format.sampleRate != outputSampleRate) &&
+		idSoundResampler::IsSupported(prepared.format.sampleRate, outputSampleRate, prepared.format.numChannels)) {
+		const sampleType_t resampledType = (bufferSampleType == sampleType_t::FLOAT32) ? sampleType_t::FLOAT32 : sampleType_t::INT16;
+		ditherState_t ditherState;
+		InitDitherState(ditherState);
+		std::vector<char> resampledData;
+		if (!ResampleSoundData(prepared.soundData, prepared.soundDataSize, bufferSampleType, prepared.format.numChannels,
+				prepared.format.sampleRate, outputSampleRate, resampledType, isDithered ? &ditherState : nullptr, resampledData) ||
+			resampledData.empty() ||
+			!GetBufferFormat(resampledType, prepared.format.numChannels, prepared.bufferFormat)) {
+			return false;
+		}
+		prepared.convertedData.swap(resampledData);
+		prepared.format.sampleRate = outputSampleRate;
+		prepared.bufferBlockAlign = uint32_t(prepared.format.numChannels) * uint32_t(GetSampleTypeSize(resampledType));
+		prepared.soundData = &prepared.convertedData[0];
+		prepared.soundDataSize = uint32_t(prepared.convertedData.size());
+		prepared.mappedFile.reset();
+	}
+	if (!prepared.mappedFile) {
+		return true;
+	}
+
+	// Touch every page of the mapping, so that the disk is read here rather than during the upload
+	uint8_t pagesSum = 0;
+	for (size_t offset = 0; offset < prepared.soundDataSize; offset += PAGE_SIZE) {
+		pagesSum += uint8_t(prepared.soundData[offset]);
+	}
+	volatile uint8_t unusedSum = pagesSum;
+	(void)unusedSum;
+
+	return true;
+}
+
+std::shared_future<soundLoadResult_t> idSoundManager::LoadWavAsync(const std::string &fileName, soundId_t &soundId, const soundPriority_t priority) {
+	soundId = soundId_t();
+
+	// Simply take a new reference if file already loaded or being loaded
+	if (FindLoadedSound(fileName, soundId)) {
+		sound_t &sound = sounds[soundId.index];
+		if (priority > sound.priority) {
+			sound.priority = priority;
+		}
+		if (sound.pendingLoad) {
+			cacheStats.hitCount++;
+			return sound.pendingLoad->completionFuture;
 		}
-		else if (bitsPerSample == 16) {
-			format = AL_FORMAT_STEREO16;
+		// A streamed or mixed file can't also be a buffer
+		const bool isBuffer = !sound.stream && !sound.isKeysound;
+		if (isBuffer) {
+			cacheStats.hitCount++;
+			sound.lastUseOrder = nextUseOrder++;
 		}
-		else {
-			alDeleteBuffers(1, &newBuffer);
-			return false;
+		std::promise<soundLoadResult_t> loaded;
+		loaded.set_value(isBuffer ? soundLoadResult_t::LOADED : soundLoadResult_t::FAILED);
+		if (!isBuffer) {
+			sound.referenceCount--;
 		}
+		return loaded.get_future().share();
+	}
+
+	if (!AllocateSound(fileName, soundId)) {
+		std::promise<soundLoadResult_t> loaded;
+		loaded.set_value(soundLoadResult_t::FAILED);
+		return loaded.get_future().share();
+	}
+	cacheStats.missCount++;
+
+	// The loading thread fills the prepared sound in place
+	sound_t &sound = sounds[soundId.index];
+	sound.priority = priority;
+	sound.pendingLoad.reset(new pendingLoad_t());
+	pendingLoad_t &pendingLoad = *sound.pendingLoad;
+	pendingLoad.isPrepared = false;
+	pendingLoad.isCancelled = false;
+	pendingLoad.uploadedSize = 0;
+	pendingLoad.completionFuture = pendingLoad.completion.get_future().share();
+	pendingLoad.preparation = std::async(std::launch::async, PrepareSound, fileName, isFloatSupported, isDithered, outputSampleRate, std::ref(pendingLoad.prepared));
+	loadingSoundIndices.push_back(soundId.index);
+
+	return pendingLoad.completionFuture;
+}
+
+void idSoundManager::SetDithering(const bool isEnabled) {
+	isDithered = isEnabled;
+}
+
+void idSoundManager::UpdateLoads() {
+	if (loadingSoundIndices.empty()) {
+		return;
+	}
+
+	const std::chrono::steady_clock::time_point deadline =
+		std::chrono::steady_clock::now() + std::chrono::milliseconds(UPLOAD_TIME_BUDGET_MS);
+	for (size_t i = 0; (i < loadingSoundIndices.size()) && (std::chrono::steady_clock::now() < deadline);) {
+		const uint16_t index = loadingSoundIndices[i];
+		const loadState_t state = ContinueLoad(sounds[index], deadline);
+		if (state == loadState_t::IN_PROGRESS) {
+			++i;
+		} else {
+			FinishLoad(index, state); // Removes the index from loading sounds
+		}
+	}
+}
+
+idSoundManager::loadState_t idSoundManager::ContinueLoad(sound_t &sound, const std::chrono::steady_clock::time_point &deadline) {
+	pendingLoad_t &load = *sound.pendingLoad;
+	preparedSound_t &prepared = load.prepared;
+
+	// Prepare OpenAL buffer once sound data has been read
+	if (!load.isPrepared) {
+		if (load.preparation.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			return loadState_t::IN_PROGRESS;
+		}
+		if (load.isCancelled) {
+			return loadState_t::CANCELLED;
+		}
+		if (!load.preparation.get()) {
+			return loadState_t::FAILED;
+		}
+		load.isPrepared = true;
+
+		alGenBuffers(1, &sound.buffer);
+		if (alGetError() != AL_NO_ERROR) {
+			sound.buffer = 0;
+			return loadState_t::FAILED;
+		}
+
+		// A static buffer reads the mapping directly and keeps it mapped until the buffer is deleted
+		if ((bufferDataStatic != nullptr) && prepared.mappedFile) {
+			bufferDataStatic(ALint(sound.buffer), prepared.bufferFormat, const_cast<char*>(prepared.soundData),
+				ALsizei(prepared.soundDataSize), prepared.format.sampleRate);
+			return (alGetError() == AL_NO_ERROR) ? loadState_t::DONE : loadState_t::FAILED;
+		}
+
+		// Without sub-data uploads, OpenAL copies the data at once
+		if (bufferSubData == nullptr) {
+			alBufferData(sound.buffer, prepared.bufferFormat, prepared.soundData,
+				ALsizei(prepared.soundDataSize), prepared.format.sampleRate);
+			prepared.mappedFile.reset();
+			return (alGetError() == AL_NO_ERROR) ? loadState_t::DONE : loadState_t::FAILED;
+		}
+
+		// Allocate buffer storage, data is then uploaded in slices
+		alBufferData(sound.buffer, prepared.bufferFormat, NULL, ALsizei(prepared.soundDataSize), prepared.format.sampleRate);
+		if (alGetError() != AL_NO_ERROR) {
+			return loadState_t::FAILED;
+		}
+	}
+
+	// Upload slices (aligned on sample frames) until the deadline
+	const uint32_t sliceSize = UPLOAD_SLICE_SIZE - (UPLOAD_SLICE_SIZE % prepared.bufferBlockAlign);
+	while (load.uploadedSize < prepared.soundDataSize) {
+		const uint32_t uploadSize = (prepared.soundDataSize - load.uploadedSize < sliceSize) ?
+			(prepared.soundDataSize - load.uploadedSize) :
+			sliceSize;
+		bufferSubData(sound.buffer, prepared.bufferFormat, prepared.soundData + load.uploadedSize,
+			ALsizei(load.uploadedSize), ALsizei(uploadSize));
+		if (alGetError() != AL_NO_ERROR) {
+			return loadState_t::FAILED;
+		}
+		load.uploadedSize += uploadSize;
+
+		if (std::chrono::steady_clock::now() >= deadline) {
+			break;
+		}
+	}
+	if (load.uploadedSize < prepared.soundDataSize) {
+		return loadState_t::IN_PROGRESS;
+	}
+
+	prepared.mappedFile.reset();
+	return loadState_t::DONE;
+}
+
+void idSoundManager::FinishLoad(const uint16_t index, const loadState_t state) {
+	sound_t &sound = sounds[index];
+	std::unique_ptr<pendingLoad_t> pendingLoad = std::move(sound.pendingLoad);
+
+	for (size_t i = 0; i < loadingSoundIndices.size(); ++i) {
+		if (loadingSoundIndices[i] == index) {
+			loadingSoundIndices[i] = loadingSoundIndices.back();
+			loadingSoundIndices.pop_back();
+			break;
+		}
+	}
+
+	if (state == loadState_t::DONE) {
+		sound.mappedFile = std::move(pendingLoad->prepared.mappedFile);
+		sound.bufferSize = pendingLoad->prepared.soundDataSize;
+		const preparedSound_t &prepared = pendingLoad->prepared;
+		sound.bufferSeconds = float(prepared.soundDataSize / prepared.bufferBlockAlign) / float(prepared.format.sampleRate);
+		cacheStats.bufferBytes += sound.bufferSize;
+		pendingLoad->completion.set_value(soundLoadResult_t::LOADED);
+		EvictCachedSounds();
 	} else {
-		alDeleteBuffers(1, &newBuffer);
+		ReleaseSound(index);
+		pendingLoad->completion.set_value((state == loadState_t::CANCELLED) ? soundLoadResult_t::CANCELLED : soundLoadResult_t::FAILED);
+	}
+}
+
+bool idSoundManager::LoadStream(const std::string &fileName, soundId_t &soundId) {
+	soundId = soundId_t();
+	ReleaseCachedSound(fileName);
+
+	// Simply take a new reference if file already opened
+	if (FindLoadedSound(fileName, soundId)) {
+		if (!sounds[soundId.index].stream) {
+			sounds[soundId.index].referenceCount--; // A loaded buffer can't also be streamed
+			return false;
+		}
+		return true;
+	}
+
+	if (!AllocateSound(fileName, soundId)) {
+		return false;
+	}
+	sound_t &sound = sounds[soundId.index];
+	sound.stream.reset(new idSoundStream());
+	if (!sound.stream->Open(fileName, isFloatSupported, isDithered, idSoundStream::STREAM_BUFFER_SIZE, outputSampleRate, sink.GetClock() != sinkClock_t::VIRTUAL)) {
+		ReleaseSound(soundId.index);
 		return false;
 	}
 
-	// Fill OpenAL buffer with data
-	alBufferData(newBuffer, format, soundData, dataSize, sampleRate);
-	delete[] soundData;
-	alError = alGetError();
-	if (alError != AL_NO_ERROR) {
-		alDeleteBuffers(1, &newBuffer);
+	return true;
+}
+
+bool idSoundManager::LoadKeysound(const std::string &fileName, soundId_t &soundId) {
+	soundId = soundId_t();
+	ReleaseCachedSound(fileName);
+
+	// Simply take a new reference if file already loaded
+	if (FindLoadedSound(fileName, soundId)) {
+		if (!sounds[soundId.index].isKeysound) {
+			sounds[soundId.index].referenceCount--; // A loaded buffer can't also be mixed
+			return false;
+		}
+		return true;
+	}
+
+	// Sound data is converted by the mixer, the file isn't needed afterwards
+	idMappedFile mappedFile;
+	wavFormat_t format;
+	const char* soundData;
+	uint32_t soundDataSize;
+	if (!mappedFile.Open(fileName) ||
+		!ParseWavFile(mappedFile.GetData(), mappedFile.GetSize(), format, soundData, soundDataSize)) {
 		return false;
 	}
 
-	// Register successfully created buffer
-	registeredBuffers[fileName] = newBuffer;
+	if (!AllocateSound(fileName, soundId)) {
+		return false;
+	}
+	sound_t &sound = sounds[soundId.index];
+	if (!mixer.AddSample(format, soundData, soundDataSize, sound.keysoundSample)) {
+		ReleaseSound(soundId.index);
+		return false;
+	}
+	sound.isKeysound = true;
 
 	return true;
 }
 
-bool idSoundManager::UnloadFile(const std::string &fileName) {
-	if (registeredBuffers.count(fileName) <= 0) {
+bool idSoundManager::Unload(const soundId_t soundId) {
+	sound_t* sound = GetSound(soundId);
+	if (sound == nullptr) {
 		return false;
 	}
 
+	// Keep sound while other references remain
+	if (sound->referenceCount > 1) {
+		sound->referenceCount--;
+		return true;
+	}
+
+	// Pending load is cancelled without waiting for the loading thread, a new load of the file gets its own slot
+	if (sound->pendingLoad) {
+		sound->referenceCount = 0;
+		soundIndices.erase(sound->fileName);
+		sound->fileName.clear();
+		if (sound->pendingLoad->isPrepared) {
+			FinishLoad(soundId.index, loadState_t::CANCELLED);
+		} else {
+			sound->pendingLoad->isCancelled = true;
+		}
+		return true;
+	}
+
+	// Loaded buffers stay cached, voices playing them aren't interrupted
+	if ((sound->buffer != 0) && !sound->stream && !sound->isKeysound) {
+		sound->referenceCount = 0;
+		sound->isCached = true;
+		cacheStats.cachedBytes += sound->bufferSize;
+		EvictCachedSounds();
+		return true;
+	}
+
 	// Delete OpenAL buffer (fails if buffer is in use)
-	ALuint buffer = registeredBuffers.at(fileName);
-	alDeleteBuffers(1, &buffer);
-	ALenum alError = alGetError();
-	if (alError != AL_NO_ERROR) {
-		return false;
+	if (sound->buffer != 0) {
+		alDeleteBuffers(1, &sound->buffer);
+		ALenum alError = alGetError();
+		if (alError != AL_NO_ERROR) {
+			return false;
+		}
+		sound->buffer = 0;
 	}
 
-	registeredBuffers.erase(fileName);
+	ReleaseSound(soundId.index);
 	return true;
 }
 
-bool idSoundManager::Play(const std::string &fileName, const bool repeat) {
-	if (registeredBuffers.count(fileName) <= 0) {
+bool idSoundManager::Play(const soundId_t soundId, const bool repeat) {
+	sound_t* sound = GetSound(soundId);
+	if (sound == nullptr) {
 		return false;
 	}
-
-	// Create new source if unplaying source pool is empty
-	if (unplayingSources.size() <= 0) {
-		ALuint newSource;
-		alGenSources(1, &newSource);
-		InitSource(newSource);
-		unplayingSources.push_back(newSource);
+	if (sound->stream) {
+		return sound->stream->Play(repeat);
+	}
+	if (sound->isKeysound) {
+		return mixer.Play(sound->keysoundSample);
+	}
+	if (sound->pendingLoad) {
+		return true;
 	}
 
 	// Retrieve buffer and source to play sound
-	ALuint source = unplayingSources.back();
-	ALuint buffer = registeredBuffers.at(fileName);
+	sound->lastUseOrder = nextUseOrder++;
+	ALuint source;
+	if (!AcquireSource(sound->priority, source)) {
+		voiceStats.droppedPlayCount++;
+		return true;
+	}
+	ALuint buffer = sound->buffer;
 
 	// Prepare source
 	alSourcei(source, AL_BUFFER, buffer);
 	alSourcei(source, AL_LOOPING, repeat? AL_TRUE : AL_FALSE);
 	ALenum alError = alGetError();
 	if (alError != AL_NO_ERROR) {
+		unplayingSources.push_back(source);
 		return false;
 	}
 
 	// Play sound and transfer source to "playing" container
 	alSourcePlay(source);
-	unplayingSources.pop_back();
-	playingSources.push_back(source);
+	voice_t voice;
+	voice.source = source;
+	voice.sound = soundId;
+	voice.priority = sound->priority;
+	voice.playOrder = nextPlayOrder++;
+	voice.isLooping = repeat;
+	voice.isPaused = false;
+	voice.expectedEndTime = repeat ? std::chrono::steady_clock::time_point::max() :
+		std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(sound->bufferSeconds));
+	playingVoices.push_back(voice);
+	voiceStats.activeVoiceCount = (unsigned int)playingVoices.size();
+	if (voiceStats.activeVoiceCount > voiceStats.peakActiveVoiceCount) {
+		voiceStats.peakActiveVoiceCount = voiceStats.activeVoiceCount;
+	}
 
 	return true;
 }
 
+bool idSoundManager::PlayAt(const soundId_t soundId, const std::chrono::steady_clock::time_point &playTime) {
+	sound_t* sound = GetSound(soundId);
+	if ((sound == nullptr) || !sound->isKeysound) {
+		return false;
+	}
+
+	return mixer.PlayAt(sound->keysoundSample, playTime);
+}
+
+bool idSoundManager::Pause(const soundId_t soundId) {
+	sound_t* sound = GetSound(soundId);
+	if (sound == nullptr) {
+		return false;
+	}
+	if (sound->stream) {
+		return sound->stream->Pause();
+	}
+
+	voice_t* voice = FindPlayingVoice(soundId);
+	if (voice == nullptr) {
+		return true;
+	}
+
+	alSourcePause(voice->source);
+	voice->isPaused = true;
+	UpdateExpectedEndTime(*voice);
+	return alGetError() == AL_NO_ERROR;
+}
+
+bool idSoundManager::Resume(const soundId_t soundId) {
+	sound_t* sound = GetSound(soundId);
+	if (sound == nullptr) {
+		return false;
+	}
+	if (sound->stream) {
+		return sound->stream->Resume();
+	}
+
+	voice_t* voice = FindPlayingVoice(soundId);
+	if (voice == nullptr) {
+		return false;
+	}
+
+	alSourcePlay(voice->source);
+	voice->isPaused = false;
+	UpdateExpectedEndTime(*voice);
+	return alGetError() == AL_NO_ERROR;
+}
+
+bool idSoundManager::Stop(const soundId_t soundId) {
+	sound_t* sound = GetSound(soundId);
+	if (sound == nullptr) {
+		return false;
+	}
+	if (sound->stream) {
+		return sound->stream->Stop();
+	}
+	if (sound->isKeysound) {
+		return mixer.StopSample(sound->keysoundSample);
+	}
+
+	voice_t* voice = FindPlayingVoice(soundId);
+	if (voice == nullptr) {
+		return true;
+	}
+
+	// Source is moved back to the unplaying pool on next update
+	alSourceStop(voice->source);
+	voice->isPaused = false;
+	voice->isLooping = false;
+	voice->expectedEndTime = std::chrono::steady_clock::time_point::min();
+	return alGetError() == AL_NO_ERROR;
+}
+
+bool idSoundManager::SetPlaybackPosition(const soundId_t soundId, const float seconds) {
+	sound_t* sound = GetSound(soundId);
+	if (sound == nullptr) {
+		return false;
+	}
+	if (sound->stream) {
+		return sound->stream->SetPlaybackPosition(seconds);
+	}
+
+	voice_t* voice = FindPlayingVoice(soundId);
+	if (voice == nullptr) {
+		return false;
+	}
+
+	alSourcef(voice->source, AL_SEC_OFFSET, seconds);
+	UpdateExpectedEndTime(*voice);
+	return alGetError() == AL_NO_ERROR;
+}
+
+bool idSoundManager::HasVoice(const soundId_t soundId) {
+	sound_t* sound = GetSound(soundId);
+	if (sound == nullptr) {
+		return false;
+	}
+	return sound->stream || (FindPlayingVoice(soundId) != nullptr);
+}
+
 void idSoundManager::UpdateSourceStates() {
-	size_t playingSize = playingSources.size();
+	UpdateOutputLatency();
+
+	voiceStats.stateQueryCount = 0;
+	size_t playingSize = playingVoices.size();
 	// If no source is playing, no need to do anything
 	if (playingSize <= 0) {
+		stoppedSources.Clear();
+		hasLostSourceEvents = false;
 		return;
 	}
 
-	// Move stopped sources to unplaying source pool
-	ALint sourceState;
-	for (int i = int(playingSize - 1); i >= 0; --i) {
-		alGetSourcei(playingSources[i], AL_SOURCE_STATE, &sourceState);
-		if (sourceState == AL_STOPPED) {
-			alSourcei(playingSources[i], AL_BUFFER, NULL);
-			unplayingSources.push_back(playingSources[i]);
-			playingSources[i] = playingSources.back();
-			playingSources.pop_back();
+	// Move stopped sources to unplaying source pool, only querying the ones that may have stopped
+	if (!voiceStats.isEventDriven || hasLostSourceEvents.exchange(false)) {
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		const bool isEachVoiceChecked = voiceStats.isEventDriven;
+		for (int i = int(playingVoices.size() - 1); i >= 0; --i) {
+			if (isEachVoiceChecked || (playingVoices[i].expectedEndTime <= now)) {
+				RecycleIfStopped(size_t(i));
+			}
+		}
+	}
+	// Events of sources that aren't voices (streams, mixer), or were replayed since, are ignored
+	ALuint stoppedSource;
+	while (stoppedSources.Pop(stoppedSource)) {
+		for (size_t i = 0; i < playingVoices.size(); ++i) {
+			if (playingVoices[i].source == stoppedSource) {
+				RecycleIfStopped(i);
+				break;
+			}
+		}
+	}
+	voiceStats.activeVoiceCount = (unsigned int)playingVoices.size();
+
+	// Cached buffers that were still playing can now be deleted
+	if ((playingVoices.size() < playingSize) && (cacheStats.bufferBytes > cacheStats.budgetBytes)) {
+		EvictCachedSounds();
+	}
+}
+
+const voiceStats_t& idSoundManager::GetVoiceStats() const {
+	return voiceStats;
+}
+
+mixerStats_t idSoundManager::GetMixerStats() {
+	return mixer.GetStats();
+}
+
+const outputLatency_t& idSoundManager::GetOutputLatency() const {
+	return outputLatency;
+}
+
+void idSoundManager::PlayPreview(const std::string &fileName, const float startSeconds, const float durationSeconds) {
+	preview.Play(fileName, startSeconds, durationSeconds);
+}
+
+void idSoundManager::StopPreview() {
+	preview.FadeOut();
+}
+
+void idSoundManager::SetCacheBudget(const size_t budgetBytes) {
+	cacheStats.budgetBytes = budgetBytes;
+	EvictCachedSounds();
+}
+
+bool idSoundManager::SetPinned(const soundId_t soundId, const bool isPinned) {
+	sound_t* sound = GetSound(soundId);
+	if (sound == nullptr) {
+		return false;
+	}
+
+	sound->isPinned = isPinned;
+	if (!isPinned) {
+		EvictCachedSounds();
+	}
+	return true;
+}
+
+const cacheStats_t& idSoundManager::GetCacheStats() const {
+	return cacheStats;
+}
+
+audioBackend_t idSoundManager::GetBackend() const {
+	return backend;
+}
+
+void idSoundManager::AdvanceClock(const float seconds) {
+	if (sink.GetClock() != sinkClock_t::VIRTUAL) {
+		return;
+	}
+
+	std::vector<idSoundStream*> streams;
+	for (sound_t &sound : sounds) {
+		if (sound.stream) {
+			streams.push_back(sound.stream.get());
 		}
 	}
+	sink.AdvanceClock(double(seconds), [this, &streams]() {
+		for (idSoundStream* stream : streams) {
+			stream->Pump();
+		}
+		mixer.Pump();
+	});
+}
+
+void idSoundManager::UpdateOutputLatency() {
+	float deviceLatency = estimatedDeviceLatency;
+	bool isMeasured = false;
+	if (getDeviceInteger64 != nullptr) {
+		ALCint64SOFT latencyNanoseconds = 0;
+		getDeviceInteger64(device, ALC_DEVICE_LATENCY_SOFT, 1, &latencyNanoseconds);
+		if (alcGetError(device) == ALC_NO_ERROR) {
+			deviceLatency = float(double(latencyNanoseconds) / 1e9);
+			isMeasured = true;
+		}
+	} else if ((getSourceDoubles != nullptr) && (mixer.GetSource() != 0)) {
+		// Second value is the latency, first one is the playback offset
+		ALdouble offsetAndLatency[2] = { 0.0, 0.0 };
+		getSourceDoubles(mixer.GetSource(), AL_SEC_OFFSET_LATENCY_SOFT, offsetAndLatency);
+		if (alGetError() == AL_NO_ERROR) {
+			deviceLatency = float(offsetAndLatency[1]);
+			isMeasured = true;
+		}
+	}
+
+	// Restart smoothing from the measure when switching between measures and estimates
+	if (isMeasured != outputLatency.isMeasured) {
+		outputLatency.deviceSeconds = deviceLatency;
+	} else {
+		outputLatency.deviceSeconds += (deviceLatency - outputLatency.deviceSeconds) * LATENCY_SMOOTHING;
+	}
+	outputLatency.mixerSeconds = (mixer.GetSource() != 0) ? mixer.GetQueuedSeconds() : 0.0f;
+	outputLatency.isMeasured = isMeasured;
+}
+
+bool idSoundManager::AcquireSource(const soundPriority_t priority, ALuint &source) {
+	if (!unplayingSources.empty()) {
+		source = unplayingSources.back();
+		unplayingSources.pop_back();
+		return true;
+	}
+
+	// Only voices with a priority up to the new sound's one can be stolen
+	size_t stolenIndex = playingVoices.size();
+	for (size_t i = 0; i < playingVoices.size(); ++i) {
+		const voice_t &voice = playingVoices[i];
+		if ((voice.priority == soundPriority_t::CRITICAL) || (voice.priority > priority)) {
+			continue;
+		}
+		if ((stolenIndex == playingVoices.size()) ||
+			(voice.priority < playingVoices[stolenIndex].priority) ||
+			((voice.priority == playingVoices[stolenIndex].priority) && (voice.playOrder < playingVoices[stolenIndex].playOrder))) {
+			stolenIndex = i;
+		}
+	}
+	if (stolenIndex == playingVoices.size()) {
+		return false;
+	}
+
+	source = playingVoices[stolenIndex].source;
+	alSourceStop(source);
+	alSourcei(source, AL_BUFFER, 0);
+	playingVoices[stolenIndex] = playingVoices.back();
+	playingVoices.pop_back();
+	voiceStats.stolenVoiceCount++;
+
+	return true;
+}
+
+bool idSoundManager::FindLoadedSound(const std::string &fileName, soundId_t &soundId) {
+	if (soundIndices.count(fileName) <= 0) {
+		return false;
+	}
+
+	sound_t &sound = sounds[soundIndices.at(fileName)];
+	if (sound.isCached) {
+		sound.isCached = false;
+		cacheStats.cachedBytes -= sound.bufferSize;
+	}
+	sound.referenceCount++;
+	soundId.index = soundIndices.at(fileName);
+	soundId.generation = sound.generation;
+	return true;
+}
+
+bool idSoundManager::AllocateSound(const std::string &fileName, soundId_t &soundId) {
+	// Reuse a released slot if possible
+	uint16_t index;
+	if (!freeSoundIndices.empty()) {
+		index = freeSoundIndices.back();
+		freeSoundIndices.pop_back();
+	} else if (sounds.size() < MAX_SOUND_COUNT) {
+		index = uint16_t(sounds.size());
+		sounds.emplace_back();
+		sounds.back().generation = 0;
+	} else if (FindEvictableSound(index)) {
+		// All slots taken, the least recently used cached buffer makes room
+		ReleaseSound(index);
+		cacheStats.evictionCount++;
+		freeSoundIndices.pop_back();
+	} else {
+		return false;
+	}
+
+	// Generation changes on each reuse so handles on the previous sound become invalid (0 is never used)
+	sound_t &sound = sounds[index];
+	sound.generation = (sound.generation == UINT16_MAX) ? 1 : sound.generation + 1;
+	sound.referenceCount = 1;
+	sound.priority = soundPriority_t::NORMAL;
+	sound.fileName = fileName;
+	sound.buffer = 0;
+	sound.bufferSize = 0;
+	sound.bufferSeconds = 0.0f;
+	sound.isCached = false;
+	sound.isPinned = false;
+	sound.lastUseOrder = nextUseOrder++;
+	sound.isKeysound = false;
+	soundIndices[fileName] = index;
+
+	soundId.index = index;
+	soundId.generation = sound.generation;
+	return true;
+}
+
+void idSoundManager::ReleaseSound(const uint16_t index) {
+	sound_t &sound = sounds[index];
+
+	// A buffer can't be deleted while voices still use it
+	for (int i = int(playingVoices.size() - 1); i >= 0; --i) {
+		if (playingVoices[i].sound.index == index) {
+			alSourceStop(playingVoices[i].source);
+			alSourcei(playingVoices[i].source, AL_BUFFER, 0);
+			unplayingSources.push_back(playingVoices[i].source);
+			playingVoices[i] = playingVoices.back();
+			playingVoices.pop_back();
+		}
+	}
+	voiceStats.activeVoiceCount = (unsigned int)playingVoices.size();
+
+	if (sound.buffer != 0) {
+		alDeleteBuffers(1, &sound.buffer);
+		sound.buffer = 0;
+	}
+	cacheStats.bufferBytes -= sound.bufferSize;
+	if (sound.isCached) {
+		cacheStats.cachedBytes -= sound.bufferSize;
+		sound.isCached = false;
+	}
+	sound.bufferSize = 0;
+	sound.mappedFile.reset();
+	sound.stream.reset();
+	if (sound.isKeysound) {
+		mixer.RemoveSample(sound.keysoundSample);
+		sound.isKeysound = false;
+	}
+	sound.referenceCount = 0;
+	soundIndices.erase(sound.fileName);
+	sound.fileName.clear();
+	freeSoundIndices.push_back(index);
+}
+
+void idSoundManager::ReleaseCachedSound(const std::string &fileName) {
+	if ((soundIndices.count(fileName) > 0) && sounds[soundIndices.at(fileName)].isCached) {
+		ReleaseSound(soundIndices.at(fileName));
+	}
+}
+
+void idSoundManager::EvictCachedSounds() {
+	uint16_t evictedIndex;
+	while ((cacheStats.bufferBytes > cacheStats.budgetBytes) && FindEvictableSound(evictedIndex)) {
+		ReleaseSound(evictedIndex);
+		cacheStats.evictionCount++;
+	}
+}
+
+bool idSoundManager::FindEvictableSound(uint16_t &index) const {
+	bool isFound = false;
+	for (size_t i = 0; i < sounds.size(); ++i) {
+		const sound_t &sound = sounds[i];
+		if (sound.isCached && !sound.isPinned && !IsSoundPlaying(uint16_t(i)) &&
+			(!isFound || (sound.lastUseOrder < sounds[index].lastUseOrder))) {
+			index = uint16_t(i);
+			isFound = true;
+		}
+	}
+	return isFound;
+}
+
+bool idSoundManager::IsSoundPlaying(const uint16_t index) const {
+	for (const voice_t &voice : playingVoices) {
+		if (voice.sound.index == index) {
+			return true;
+		}
+	}
+	return false;
+}
+
+idSoundManager::sound_t* idSoundManager::GetSound(const soundId_t soundId) {
+	if ((soundId.index >= sounds.size()) ||
+		(sounds[soundId.index].generation != soundId.generation) ||
+		(sounds[soundId.index].referenceCount <= 0)) {
+		return nullptr;
+	}
+
+	return &sounds[soundId.index];
+}
+
+idSoundManager::voice_t* idSoundManager::FindPlayingVoice(const soundId_t soundId) {
+	// Paused sources stay in the "playing" container
+	for (voice_t &voice : playingVoices) {
+		if ((voice.sound.index == soundId.index) && (voice.sound.generation == soundId.generation)) {
+			return &voice;
+		}
+	}
+
+	return nullptr;
+}
+
+void idSoundManager::UpdateExpectedEndTime(voice_t &voice) {
+	if (voice.isLooping || voice.isPaused) {
+		voice.expectedEndTime = std::chrono::steady_clock::time_point::max();
+		return;
+	}
+
+	ALfloat offsetSeconds = 0.0f;
+	alGetSourcef(voice.source, AL_SEC_OFFSET, &offsetSeconds);
+	const float secondsLeft = (std::max)(sounds[voice.sound.index].bufferSeconds - offsetSeconds, 0.0f);
+	voice.expectedEndTime = std::chrono::steady_clock::now() +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(secondsLeft));
+}
+
+bool idSoundManager::RecycleIfStopped(const size_t voiceIndex) {
+	ALint sourceState;
+	alGetSourcei(playingVoices[voiceIndex].source, AL_SOURCE_STATE, &sourceState);
+	voiceStats.stateQueryCount++;
+	if (sourceState != AL_STOPPED) {
+		return false;
+	}
+
+	alSourcei(playingVoices[voiceIndex].source, AL_BUFFER, 0);
+	unplayingSources.push_back(playingVoices[voiceIndex].source);
+	playingVoices[voiceIndex] = playingVoices.back();
+	playingVoices.pop_back();
+	return true;
+}
+
+void AL_APIENTRY idSoundManager::OnSourceEvent(ALenum eventType, ALuint object, ALuint param, ALsizei /*length*/, const ALchar* /*message*/, void* userParam) {
+	if ((eventType != AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT) || (param != AL_STOPPED)) {
+		return;
+	}
+
+	idSoundManager* const manager = static_cast<idSoundManager*>(userParam);
+	if (!manager->stoppedSources.Push(object)) {
+		manager->hasLostSourceEvents = true;
+	}
 }
 
 void idSoundManager::InitSource(const ALuint &source) {
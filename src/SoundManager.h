@@ -3,30 +3,277 @@
 
 #include <OpenAL/al.h>
 #include <OpenAL/alc.h>
+#include <OpenAL/alext.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
+#include <memory>
+#include <future>
+#include <chrono>
+#include <atomic>
 #include <unordered_map>
 
+#include "MappedFile.h"
+#include "SoundUtils.h"
+#include "SoundStream.h"
+#include "SoundMixer.h"
+#include "SoundSink.h"
+#include "SoundPreview.h"
+#include "SpscQueue.h"
+
+// Handle on a loaded sound, it becomes invalid once the sound is unloaded
+struct soundId_t {
+	uint16_t index;
+	uint16_t generation; // Never 0 for a valid handle, so a zeroed handle is invalid
+};
+
+// Outcome of an asynchronous load, loads cancelled by unloading the sound aren't failures
+enum class soundLoadResult_t {
+	LOADED,
+	FAILED,
+	CANCELLED
+};
+
+// Voices playing lower priority sounds are stolen first when every voice is in use
+enum class soundPriority_t {
+	LOW,
+	NORMAL,
+	CRITICAL // Never stolen
+};
+
+struct voiceStats_t {
+	unsigned int voiceCount; // Size of the voice pool
+	unsigned int activeVoiceCount;
+	unsigned int peakActiveVoiceCount;
+	unsigned int stolenVoiceCount; // Voices stopped early to play another sound
+	unsigned int droppedPlayCount; // Sounds not played because no voice could be stolen
+	unsigned int stateQueryCount; // Source states queried by the latest update
+	bool isEventDriven; // Whether ended voices are reported by the driver rather than predicted
+};
+
+struct cacheStats_t {
+	unsigned int hitCount; // Buffer loads finding the file already loaded or cached
+	unsigned int missCount; // Buffer loads reading the file
+	unsigned int evictionCount; // Cached buffers deleted to stay within the budget
+	size_t bufferBytes; // Sound data of every loaded buffer, referenced or cached
+	size_t cachedBytes; // Part of it only kept by the cache
+	size_t budgetBytes;
+};
+
+enum class audioBackend_t {
+	AUTOMATIC, // Chosen by the environment, the sound device by default
+	DEVICE, // Default sound device, the null sink is used instead if it can't be opened
+	NULL_SINK, // Output is rendered at the pace of the system clock (or of a virtual one) and dropped
+	FILE_SINK, // Same as the null sink, but the output is written to a WAV file
+	NONE // No output could be opened, sounds can't be loaded
+};
+
+struct outputLatency_t {
+	float deviceSeconds; // Between a sample being mixed by OpenAL and reaching the device output
+	float mixerSeconds; // Added on top for keysounds by the blocks queued by the software mixer
+	bool isMeasured; // Estimated from the device update rate when the driver can't report it
+};
+
 class idSoundManager {
 	public:
-		idSoundManager();
+		// The sink file name is only used by the file sink (taken from the environment if it's empty)
+		idSoundManager(const audioBackend_t requestedBackend=audioBackend_t::AUTOMATIC, const std::string &sinkFileName="");
 		~idSoundManager();
 
-		bool LoadWav(const std::string &fileName);
-		bool UnloadFile(const std::string &fileName);
-		bool Play(const std::string &fileName, const bool repeat=false);
+		// Loads the file or takes another reference on it if it's already loaded
+		bool LoadWav(const std::string &fileName, soundId_t &soundId, const soundPriority_t priority=soundPriority_t::NORMAL);
+		// Same as LoadWav, but returns right away : the file is read on a worker thread and uploaded
+		// a slice at a time by UpdateLoads, the future tells how the load ended once it's done
+		std::shared_future<soundLoadResult_t> LoadWavAsync(const std::string &fileName, soundId_t &soundId, const soundPriority_t priority=soundPriority_t::NORMAL);
+		// Same as LoadWav, but the file is streamed from disk while playing (it can only be played once at a time)
+		bool LoadStream(const std::string &fileName, soundId_t &soundId);
+		// Same as LoadWav, but the sound is played by the software mixer (for short sounds played very often)
+		bool LoadKeysound(const std::string &fileName, soundId_t &soundId);
+		// Releases a reference on the sound, its data is deleted once no reference remains
+		// (buffers are kept in the cache instead, and loading their file again takes them back)
+		bool Unload(const soundId_t soundId);
+		// Sounds still loading, or that can't get a voice, are silently skipped
+		bool Play(const soundId_t soundId, const bool repeat=false);
+		// Only keysounds can be scheduled: the mixer starts them on the frame OpenAL plays at that time (the output
+		// latency comes on top, as for sounds played right away), or as soon as possible if it's too late.
+		// Stopping the sound also cancels its scheduled plays
+		bool PlayAt(const soundId_t soundId, const std::chrono::steady_clock::time_point &playTime);
+		// Control the source currently playing the sound. A sound whose voice ended or was taken by another
+		// sound has nothing to pause or stop, but can't be resumed or moved (it has to be played again).
+		bool Pause(const soundId_t soundId);
+		bool Resume(const soundId_t soundId);
+		bool Stop(const soundId_t soundId);
+		bool SetPlaybackPosition(const soundId_t soundId, const float seconds);
+		// Whether a voice still plays the sound or holds it paused (streams always keep theirs)
+		bool HasVoice(const soundId_t soundId);
 		void UpdateSourceStates();
+		// Continues pending asynchronous loads, must be called regularly from the thread owning the sound manager
+		void UpdateLoads();
+		// Whether dither noise is added when samples are reduced to 16 bits (sounds loaded afterwards only)
+		void SetDithering(const bool isEnabled);
+		const voiceStats_t& GetVoiceStats() const;
+		mixerStats_t GetMixerStats();
+		// Updated along with source states
+		const outputLatency_t& GetOutputLatency() const;
+		// Loops an excerpt of the file, replacing the current preview (files are opened in the background)
+		void PlayPreview(const std::string &fileName, const float startSeconds, const float durationSeconds);
+		void StopPreview();
+		// Cached buffers are deleted, least recently used first, while loaded buffers take more than
+		// the budget (referenced buffers and buffers still playing are never deleted)
+		void SetCacheBudget(const size_t budgetBytes);
+		// Pinned buffers stay cached whatever the budget
+		bool SetPinned(const soundId_t soundId, const bool isPinned);
+		const cacheStats_t& GetCacheStats() const;
+		// Backend actually used, after falling back from the requested one
+		audioBackend_t GetBackend() const;
+		// Moves sink output forward when it's rendered on a virtual clock (ASCII_GAME_AUDIO_CLOCK=virtual),
+		// sources only advance through these calls then, and streams and keysounds are refilled before each
+		// rendered block. Does nothing with other outputs.
+		void AdvanceClock(const float seconds);
 	private:
-		static const uint32_t INITIAL_SOURCE_COUNT = 16;
+		// Environment variables read by the automatic backend ("device", "null" or "file")
+		static const char* const BACKEND_VARIABLE;
+		static const char* const SINK_FILE_VARIABLE;
+		static const char* const CLOCK_VARIABLE;
+		static const char* const DEFAULT_SINK_FILE_NAME;
+		static const uint32_t MAX_VOICE_COUNT = 32;
+		static const size_t MAX_SOUND_COUNT = UINT16_MAX;
+		static const uint32_t UPLOAD_SLICE_SIZE = 64 * 1024;
+		// Time spent uploading pending loads on each update
+		static const unsigned int UPLOAD_TIME_BUDGET_MS = 2;
+		static const size_t DEFAULT_CACHE_BUDGET_BYTES = 128 * 1024 * 1024;
+		// Room for the source state events received between two updates
+		static const size_t SOURCE_EVENT_QUEUE_SIZE = 256;
+		// Number of device updates assumed to be buffered when latency can't be measured (OpenAL Soft's default)
+		static const int ESTIMATED_DEVICE_UPDATE_COUNT = 3;
+		// Latency used when the device doesn't even report its update rate
+		static const float DEFAULT_DEVICE_LATENCY_SECONDS;
+		// Weight of a new latency measure, they jitter by up to a device update
+		static const float LATENCY_SMOOTHING;
+
+		enum class loadState_t {
+			IN_PROGRESS,
+			DONE,
+			FAILED,
+			CANCELLED
+		};
 
+		// Sound data read by a loading thread
+		struct preparedSound_t {
+			std::unique_ptr<idMappedFile> mappedFile;
+			wavFormat_t format;
+			ALenum bufferFormat;
+			uint32_t bufferBlockAlign; // Differs from the file's one when samples are converted
+			const char* soundData; // Points in the mapping, or in the converted data
+			uint32_t soundDataSize;
+			std::vector<char> convertedData;
+		};
+
+		struct pendingLoad_t {
+			std::future<bool> preparation;
+			preparedSound_t prepared;
+			bool isPrepared;
+			bool isCancelled; // Finished by UpdateLoads once the loading thread is done
+			uint32_t uploadedSize;
+			std::promise<soundLoadResult_t> completion;
+			std::shared_future<soundLoadResult_t> completionFuture;
+		};
+
+		struct voice_t {
+			ALuint source;
+			soundId_t sound;
+			soundPriority_t priority;
+			uint64_t playOrder; // Older voices have lower values
+			bool isLooping;
+			bool isPaused;
+			// Source state is only queried from then on (looping and paused voices never end by themselves)
+			std::chrono::steady_clock::time_point expectedEndTime;
+		};
+
+		// Slot of the sounds array, a sound is either a buffer, a stream, a mixer sample or still loading
+		struct sound_t {
+			unsigned int referenceCount; // 0 when the slot is free or only cached
+			uint16_t generation;
+			soundPriority_t priority;
+			std::string fileName;
+			ALuint buffer;
+			uint32_t bufferSize; // Size of the buffer data once loaded
+			float bufferSeconds;
+			bool isCached; // Unreferenced buffer kept until the cache needs its memory
+			bool isPinned;
+			uint64_t lastUseOrder; // Less recently loaded or played sounds have lower values
+			std::unique_ptr<idMappedFile> mappedFile; // Backs the buffer data when it is static
+			std::unique_ptr<idSoundStream> stream;
+			bool isKeysound;
+			mixSampleId_t keysoundSample; // Handle of the sample in the mixer
+			std::unique_ptr<pendingLoad_t> pendingLoad; // Heap allocated so the loading thread can fill it in place
+		};
+
+		audioBackend_t backend;
+		idSoundSink sink;
 		ALCdevice* device;
 		ALCcontext* context;
+		PFNALBUFFERDATASTATICPROC bufferDataStatic;
+		PFNALBUFFERSUBDATASOFTPROC bufferSubData;
+		LPALCGETINTEGER64VSOFT getDeviceInteger64;
+		LPALGETSOURCEDVSOFT getSourceDoubles;
+		LPALEVENTCALLBACKSOFT eventCallback;
+		// Sources reported stopped by the driver's event thread
+		idSpscQueue<ALuint, SOURCE_EVENT_QUEUE_SIZE> stoppedSources;
+		std::atomic<bool> hasLostSourceEvents; // All voices are queried when the queue overflowed
+		bool isFloatSupported; // Samples wider than 16 bits are converted to floats rather than to 16 bits
+		bool isDithered;
+		int32_t outputSampleRate; // Rate sounds are resampled to when loaded (0 when the device doesn't report it)
+		float estimatedDeviceLatency;
 		std::vector<ALuint> unplayingSources;
-		std::vector<ALuint> playingSources;
-		std::unordered_map<std::string, ALuint> registeredBuffers;
-		
+		std::vector<voice_t> playingVoices;
+		idSoundMixer mixer;
+		idSoundPreview preview;
+		uint64_t nextPlayOrder;
+		voiceStats_t voiceStats;
+		cacheStats_t cacheStats;
+		uint64_t nextUseOrder;
+		outputLatency_t outputLatency;
+		std::vector<sound_t> sounds;
+		std::vector<uint16_t> freeSoundIndices;
+		std::vector<uint16_t> loadingSoundIndices;
+		std::unordered_map<std::string, uint16_t> soundIndices; // Only used when loading files
+
+		// Creates the device and context of the backend, or of the ones it falls back to
+		void OpenBackend(const audioBackend_t requestedBackend, const std::string &sinkFileName);
 		void InitSource(const ALuint &source);
+		// Takes an unplaying source, or steals the voice with the lowest priority (the oldest one among equals)
+		bool AcquireSource(const soundPriority_t priority, ALuint &source);
+		// Takes another reference on the file if it's already loaded
+		bool FindLoadedSound(const std::string &fileName, soundId_t &soundId);
+		bool AllocateSound(const std::string &fileName, soundId_t &soundId);
+		void ReleaseSound(const uint16_t index);
+		// Deletes the cached buffer of the file (if any), so it can be loaded as a stream or a keysound
+		void ReleaseCachedSound(const std::string &fileName);
+		// Deletes cached buffers until loaded buffers fit in the budget
+		void EvictCachedSounds();
+		// Least recently used cached buffer that can be deleted
+		bool FindEvictableSound(uint16_t &index) const;
+		bool IsSoundPlaying(const uint16_t index) const;
+		// Returns nullptr if the handle is invalid
+		sound_t* GetSound(const soundId_t soundId);
+		// Reads and checks the sound data (runs on a loading thread)
+		static bool PrepareSound(const std::string fileName, const bool isFloatSupported, const bool isDithered, const int32_t outputSampleRate, preparedSound_t &prepared);
+		// Uploads the prepared sound data until the deadline is reached
+		loadState_t ContinueLoad(sound_t &sound, const std::chrono::steady_clock::time_point &deadline);
+		// Keeps the loaded buffer (or releases the sound on failure) and completes the load
+		void FinishLoad(const uint16_t index, const loadState_t state);
+		// Returns nullptr if the sound has no voice (paused voices are still playing ones)
+		voice_t* FindPlayingVoice(const soundId_t soundId);
+		// Predicts when the voice's buffer will be over from its playback offset
+		void UpdateExpectedEndTime(voice_t &voice);
+		// Moves the voice's source back to the unplaying pool if it has stopped
+		bool RecycleIfStopped(const size_t voiceIndex);
+		// Runs on the driver's event thread
+		static void AL_APIENTRY OnSourceEvent(ALenum eventType, ALuint object, ALuint param, ALsizei length, const ALchar* message, void* userParam);
+		// Queries the device clock, or the latency of the always playing mixer source
+		void UpdateOutputLatency();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,461 @@
+#include <chrono>
+#ifdef _WIN32
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+#include "SoundMixer.h"
+#include "SoundResampler.h"
+
+// SSE2 is always available on x86 and x64 Windows targets
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOUND_MIXER_SSE2
+#endif
+
+const unsigned int idSoundMixer::MIN_MIX_BUFFER_COUNT;
+const unsigned int idSoundMixer::MAX_MIX_BUFFER_COUNT;
+const unsigned int idSoundMixer::DEFAULT_MIX_BUFFER_COUNT;
+const unsigned int idSoundMixer::MIX_INTERVAL_MS;
+const float idSoundMixer::CLOCK_SMOOTHING = 0.01f;
+const float idSoundMixer::CLOCK_RESYNC_SECONDS = 0.01f;
+
+// Adds the 16-bit samples, scaled by the gain, to the mix
+static void MixSamples(const int16_t* const samples, const uint32_t sampleCount, const float gain, float* const mix) {
+	uint32_t i = 0;
+#ifdef SOUND_MIXER_SSE2
+	const __m128 gains = _mm_set1_ps(gain);
+	for (; i + 8 <= sampleCount; i += 8) {
+		// Sign-extend 8 samples to 32-bit integers by placing them in the high halves
+		const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+		const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+		const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+		_mm_storeu_ps(mix + i, _mm_add_ps(_mm_loadu_ps(mix + i), _mm_mul_ps(_mm_cvtepi32_ps(low), gains)));
+		_mm_storeu_ps(mix + i + 4, _mm_add_ps(_mm_loadu_ps(mix + i + 4), _mm_mul_ps(_mm_cvtepi32_ps(high), gains)));
+	}
+#endif
+	// Voices starting inside a block leave a few samples
+	for (; i < sampleCount; ++i) {
+		mix[i] += float(samples[i]) * gain;
+	}
+}
+
+// Converts the mix back to saturated 16-bit samples (sampleCount must be a multiple of 8)
+static void ConvertMix(const float* const mix, const uint32_t sampleCount, int16_t* const output) {
+#ifdef SOUND_MIXER_SSE2
+	// Values are clamped first as out of range conversions don't saturate
+	const __m128 minValues = _mm_set1_ps(-32768.0f);
+	const __m128 maxValues = _mm_set1_ps(32767.0f);
+	for (uint32_t i = 0; i < sampleCount; i += 8) {
+		const __m128 low = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + i), minValues), maxValues);
+		const __m128 high = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + i + 4), minValues), maxValues);
+		const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), packed);
+	}
+#else
+	for (uint32_t i = 0; i < sampleCount; ++i) {
+		const float value = (mix[i] < -32768.0f) ? -32768.0f : ((mix[i] > 32767.0f) ? 32767.0f : mix[i]);
+		output[i] = int16_t((value < 0.0f) ? (value - 0.5f) : (value + 0.5f));
+	}
+#endif
+}
+
+idSoundMixer::idSoundMixer()
+: source(0)
+, buffers()
+, samples()
+, freeSampleIndices()
+, voiceCount(0)
+, stats()
+, mixedFrameCount(0)
+, isClockSet(false)
+, clockFrame(0)
+, clockTime()
+, shouldStop(false) {}
+
+idSoundMixer::~idSoundMixer() {
+	Stop();
+}
+
+bool idSoundMixer::Start(const int32_t deviceRefreshRate, const bool hasThread) {
+	Stop();
+
+	// The device mixes a whole update ahead, blocks must stay queued past the next one even when feeding is late
+	unsigned int bufferCount = DEFAULT_MIX_BUFFER_COUNT;
+	if (deviceRefreshRate > 0) {
+		const unsigned int updateFrames = (unsigned int)(MIX_SAMPLE_RATE / deviceRefreshRate);
+		bufferCount = (2 * updateFrames + MIX_BLOCK_FRAMES - 1) / MIX_BLOCK_FRAMES + 1;
+		bufferCount = (bufferCount < MIN_MIX_BUFFER_COUNT) ? MIN_MIX_BUFFER_COUNT : ((bufferCount > MAX_MIX_BUFFER_COUNT) ? MAX_MIX_BUFFER_COUNT : bufferCount);
+	}
+
+	alGenSources(1, &source);
+	if (alGetError() != AL_NO_ERROR) {
+		source = 0;
+		return false;
+	}
+	buffers.assign(bufferCount, 0);
+	alGenBuffers(ALsizei(buffers.size()), &buffers[0]);
+	if (alGetError() != AL_NO_ERROR) {
+		alDeleteSources(1, &source);
+		source = 0;
+		buffers.clear();
+		return false;
+	}
+	alSourcef(source, AL_PITCH, 1);
+	alSourcef(source, AL_GAIN, 1.0f);
+	alSource3f(source, AL_POSITION, 0, 0, 0);
+	alSource3f(source, AL_VELOCITY, 0, 0, 0);
+	alSourcei(source, AL_LOOPING, AL_FALSE);
+
+	// Output starts with silent blocks and never stops, so triggering a sample only costs the queued blocks
+	voiceCount = 0;
+	mixedFrameCount = 0;
+	isClockSet = false;
+	for (const ALuint buffer : buffers) {
+		MixBlock();
+		alBufferData(buffer, AL_FORMAT_STEREO16, outputBlock, ALsizei(sizeof(outputBlock)), MIX_SAMPLE_RATE);
+	}
+	alSourceQueueBuffers(source, ALsizei(buffers.size()), &buffers[0]);
+	alSourcePlay(source);
+	if (alGetError() != AL_NO_ERROR) {
+		Stop();
+		return false;
+	}
+	UpdateClock();
+	if (!hasThread) {
+		return true;
+	}
+
+	// Sleeps otherwise last a whole scheduler tick (about 15.6ms) on Windows
+#ifdef _WIN32
+	timeBeginPeriod(1);
+#endif
+	shouldStop = false;
+	mixThread = std::thread(&idSoundMixer::MixLoop, this);
+
+	return true;
+}
+
+void idSoundMixer::Stop() {
+	if (mixThread.joinable()) {
+		shouldStop = true;
+		mixThread.join();
+#ifdef _WIN32
+		timeEndPeriod(1);
+#endif
+	}
+
+	if (source != 0) {
+		alSourceStop(source);
+		alSourcei(source, AL_BUFFER, 0);
+		alDeleteSources(1, &source);
+		alDeleteBuffers(ALsizei(buffers.size()), &buffers[0]);
+		source = 0;
+		buffers.clear();
+	}
+	commands.Clear();
+	voiceCount = 0;
+}
+
+bool idSoundMixer::AddSample(const wavFormat_t &format, const char* const soundData, const uint32_t soundDataSize, mixSampleId_t &sampleId) {
+	ALenum bufferFormat;
+	sampleType_t sampleType, bufferSampleType;
+	if (!GetWavBufferFormat(format, false, bufferFormat, bufferSampleType) ||
+		!GetWavSampleType(format, sampleType) ||
+		((format.sampleRate != MIX_SAMPLE_RATE) && !idSoundResampler::IsSupported(format.sampleRate, MIX_SAMPLE_RATE, format.numChannels))) {
+		return false;
+	}
+
+	// Samples wider than 16 bits are reduced and compressed ones decoded first
+	const char* samplesData = soundData;
+	uint32_t samplesBlockAlign = uint32_t(format.blockAlign);
+	uint32_t frameCount = soundDataSize / samplesBlockAlign;
+	std::vector<char> convertedData;
+	if (bufferSampleType != sampleType) {
+		convertedData.resize(GetConvertedWavDataSize(format, bufferSampleType, soundDataSize));
+		if (!convertedData.empty() &&
+			!ConvertWavData(format, soundData, soundDataSize, &convertedData[0], bufferSampleType, nullptr)) {
+			return false;
+		}
+		samplesData = convertedData.data();
+		samplesBlockAlign = uint32_t(format.numChannels) * uint32_t(GetSampleTypeSize(bufferSampleType));
+		// Padding decoded at the end of the last compressed block isn't played
+		frameCount = uint32_t(GetWavFrameCount(format, soundDataSize));
+	}
+
+	// Samples at other rates are resampled to the mixer one, as 16-bit samples
+	std::vector<char> resampledData;
+	if (format.sampleRate != MIX_SAMPLE_RATE) {
+		if (!ResampleSoundData(samplesData, size_t(frameCount) * samplesBlockAlign, bufferSampleType, format.numChannels,
+			format.sampleRate, MIX_SAMPLE_RATE, sampleType_t::INT16, nullptr, resampledData)) {
+			return false;
+		}
+		bufferSampleType = sampleType_t::INT16;
+		samplesData = resampledData.data();
+		samplesBlockAlign = uint32_t(format.numChannels) * 2;
+		frameCount = uint32_t(resampledData.size() / samplesBlockAlign);
+	}
+
+	// Convert to interleaved 16-bit stereo, padded to a multiple of 4 frames so voices are mixed 8 samples at a time
+	const uint32_t paddedFrameCount = (frameCount + 3) & ~uint32_t(3);
+	std::vector<int16_t> frames(paddedFrameCount * MIX_CHANNEL_COUNT, 0);
+	for (uint32_t i = 0; i < frameCount; ++i) {
+		const char* const frame = samplesData + i * samplesBlockAlign;
+		for (unsigned int channel = 0; channel < MIX_CHANNEL_COUNT; ++channel) {
+			// Mono sounds play on both channels
+			const int32_t sourceChannel = (format.numChannels == 1) ? 0 : int32_t(channel);
+			int16_t value;
+			if (bufferSampleType == sampleType_t::UINT8) {
+				value = int16_t((int32_t(uint8_t(frame[sourceChannel])) - 128) << 8);
+			} else {
+				value = int16_t(uint16_t(uint8_t(frame[sourceChannel * 2])) | (uint16_t(uint8_t(frame[sourceChannel * 2 + 1])) << 8));
+			}
+			frames[i * MIX_CHANNEL_COUNT + channel] = value;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mixMutex);
+	uint32_t sampleIndex;
+	if (!freeSampleIndices.empty()) {
+		sampleIndex = freeSampleIndices.back();
+		freeSampleIndices.pop_back();
+	} else {
+		sampleIndex = uint32_t(samples.size());
+		samples.emplace_back();
+		samples[sampleIndex].generation = 0;
+	}
+	samples[sampleIndex].frames.swap(frames);
+	samples[sampleIndex].isUsed = true;
+	sampleId.index = sampleIndex;
+	sampleId.generation = samples[sampleIndex].generation;
+
+	return true;
+}
+
+void idSoundMixer::RemoveSample(const mixSampleId_t &sampleId) {
+	std::lock_guard<std::mutex> lock(mixMutex);
+	if (!IsSampleValid(sampleId)) {
+		return;
+	}
+	const uint32_t sampleIndex = sampleId.index;
+
+	for (int i = int(voiceCount) - 1; i >= 0; --i) {
+		if (voices[i].sampleIndex == sampleIndex) {
+			RemoveVoice((unsigned int)i);
+		}
+	}
+	stats.activeVoiceCount = voiceCount;
+	samples[sampleIndex].frames = std::vector<int16_t>();
+	samples[sampleIndex].isUsed = false;
+	samples[sampleIndex].generation++;
+	freeSampleIndices.push_back(sampleIndex);
+}
+
+bool idSoundMixer::Play(const mixSampleId_t &sampleId, const float gain) {
+	if (source == 0) {
+		return false;
+	}
+
+	mixCommand_t command = { mixCommand_t::type_t::PLAY, sampleId, gain, false, std::chrono::steady_clock::time_point() };
+	return commands.Push(command);
+}
+
+bool idSoundMixer::PlayAt(const mixSampleId_t &sampleId, const std::chrono::steady_clock::time_point &startTime, const float gain) {
+	if (source == 0) {
+		return false;
+	}
+
+	mixCommand_t command = { mixCommand_t::type_t::PLAY, sampleId, gain, true, startTime };
+	return commands.Push(command);
+}
+
+bool idSoundMixer::StopSample(const mixSampleId_t &sampleId) {
+	if (source == 0) {
+		return false;
+	}
+
+	mixCommand_t command = { mixCommand_t::type_t::STOP, sampleId, 0.0f, false, std::chrono::steady_clock::time_point() };
+	return commands.Push(command);
+}
+
+mixerStats_t idSoundMixer::GetStats() {
+	std::lock_guard<std::mutex> lock(mixMutex);
+	return stats;
+}
+
+ALuint idSoundMixer::GetSource() const {
+	return source;
+}
+
+float idSoundMixer::GetQueuedSeconds() const {
+	return float(buffers.size() * MIX_BLOCK_FRAMES) / float(MIX_SAMPLE_RATE);
+}
+
+void idSoundMixer::Pump() {
+	std::lock_guard<std::mutex> lock(mixMutex);
+	if ((source != 0) && !mixThread.joinable()) {
+		Feed();
+	}
+}
+
+void idSoundMixer::MixLoop() {
+	while (!shouldStop) {
+		{
+			std::lock_guard<std::mutex> lock(mixMutex);
+			Feed();
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(MIX_INTERVAL_MS));
+	}
+}
+
+void idSoundMixer::Feed() {
+	// Refill blocks the source is done with, commands are applied as late as possible to keep latency low
+	ALint processedCount;
+	alGetSourcei(source, AL_BUFFERS_PROCESSED, &processedCount);
+	for (ALint i = 0; i < processedCount; ++i) {
+		ALuint buffer;
+		alSourceUnqueueBuffers(source, 1, &buffer);
+		ApplyCommands();
+		MixBlock();
+		alBufferData(buffer, AL_FORMAT_STEREO16, outputBlock, ALsizei(sizeof(outputBlock)), MIX_SAMPLE_RATE);
+		alSourceQueueBuffers(source, 1, &buffer);
+	}
+
+	// The source stops by itself when every block was played before being refilled
+	ALint state;
+	alGetSourcei(source, AL_SOURCE_STATE, &state);
+	if (state != AL_PLAYING) {
+		stats.underrunCount++;
+		alSourcePlay(source);
+	}
+
+	UpdateClock();
+}
+
+void idSoundMixer::UpdateClock() {
+	// Offset is counted from the first queued block, the last one ends on the next mixed frame
+	ALint queuedCount = 0;
+	ALint sampleOffset = 0;
+	alGetSourcei(source, AL_BUFFERS_QUEUED, &queuedCount);
+	alGetSourcei(source, AL_SAMPLE_OFFSET, &sampleOffset);
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	const uint64_t playedFrame = mixedFrameCount - uint64_t(queuedCount) * MIX_BLOCK_FRAMES + uint64_t(sampleOffset);
+
+	// The play position is only updated once per device period, so it's smoothed into the clock
+	if (isClockSet) {
+		const std::chrono::steady_clock::time_point predictedTime = clockTime +
+			std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((double(playedFrame) - double(clockFrame)) / double(MIX_SAMPLE_RATE)));
+		const float error = std::chrono::duration<float>(now - predictedTime).count();
+		if ((error < CLOCK_RESYNC_SECONDS) && (error > -CLOCK_RESYNC_SECONDS)) {
+			clockFrame = playedFrame;
+			clockTime = predictedTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(error * CLOCK_SMOOTHING));
+			return;
+		}
+	}
+	clockFrame = playedFrame;
+	clockTime = now;
+	isClockSet = true;
+}
+
+uint64_t idSoundMixer::GetFrameForTime(const std::chrono::steady_clock::time_point &time) const {
+	if (!isClockSet) {
+		return mixedFrameCount;
+	}
+
+	const double frame = double(clockFrame) + std::chrono::duration<double>(time - clockTime).count() * double(MIX_SAMPLE_RATE);
+	return (frame > 0.0) ? uint64_t(frame + 0.5) : 0;
+}
+
+void idSoundMixer::ApplyCommands() {
+	mixCommand_t command;
+	while (commands.Pop(command)) {
+		// Commands sent before their sample was removed are dropped
+		if (!IsSampleValid(command.sampleId)) {
+			continue;
+		}
+
+		if (command.type == mixCommand_t::type_t::PLAY) {
+			// Cut the voice closest to its end, the one with the fewest frames left to mix
+			if (voiceCount >= MAX_MIX_VOICE_COUNT) {
+				unsigned int endingIndex = 0;
+				size_t endingRemainingFrames = SIZE_MAX;
+				for (unsigned int i = 0; i < voiceCount; ++i) {
+					const size_t remainingFrames = samples[voices[i].sampleIndex].frames.size() / MIX_CHANNEL_COUNT - voices[i].position;
+					if (remainingFrames < endingRemainingFrames) {
+						endingIndex = i;
+						endingRemainingFrames = remainingFrames;
+					}
+				}
+				RemoveVoice(endingIndex);
+				stats.droppedVoiceCount++;
+			}
+			mixVoice_t &voice = voices[voiceCount++];
+			voice.sampleIndex = command.sampleId.index;
+			voice.position = 0;
+			voice.startFrame = mixedFrameCount;
+			voice.gain = command.gain;
+			if (command.isScheduled) {
+				const uint64_t startFrame = GetFrameForTime(command.startTime);
+				if (startFrame >= mixedFrameCount) {
+					voice.startFrame = startFrame;
+				} else {
+					stats.lateScheduleCount++;
+				}
+			}
+			if (voiceCount > stats.peakActiveVoiceCount) {
+				stats.peakActiveVoiceCount = voiceCount;
+			}
+		} else {
+			for (int i = int(voiceCount) - 1; i >= 0; --i) {
+				if (voices[i].sampleIndex == command.sampleId.index) {
+					RemoveVoice((unsigned int)i);
+				}
+			}
+		}
+	}
+	stats.activeVoiceCount = voiceCount;
+}
+
+void idSoundMixer::MixBlock() {
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	for (float &value : mixBuffer) {
+		value = 0.0f;
+	}
+
+	const uint64_t blockStartFrame = mixedFrameCount;
+	for (int i = int(voiceCount) - 1; i >= 0; --i) {
+		mixVoice_t &voice = voices[i];
+		if (voice.startFrame >= blockStartFrame + MIX_BLOCK_FRAMES) {
+			continue; // Scheduled in a later block
+		}
+		const std::vector<int16_t> &frames = samples[voice.sampleIndex].frames;
+		const uint32_t sampleFrameCount = uint32_t(frames.size() / MIX_CHANNEL_COUNT);
+
+		// Scheduled voices start on their exact frame inside the block
+		const uint32_t blockOffset = (voice.startFrame > blockStartFrame) ? uint32_t(voice.startFrame - blockStartFrame) : 0;
+		const uint32_t remainingFrameCount = sampleFrameCount - voice.position;
+		const uint32_t frameCount = (remainingFrameCount < MIX_BLOCK_FRAMES - blockOffset) ? remainingFrameCount : (MIX_BLOCK_FRAMES - blockOffset);
+		if (frameCount > 0) {
+			MixSamples(&frames[voice.position * MIX_CHANNEL_COUNT], frameCount * MIX_CHANNEL_COUNT, voice.gain, mixBuffer + blockOffset * MIX_CHANNEL_COUNT);
+		}
+		voice.position += frameCount;
+		if (voice.position >= sampleFrameCount) {
+			RemoveVoice((unsigned int)i);
+		}
+	}
+	ConvertMix(mixBuffer, MIX_BLOCK_FRAMES * MIX_CHANNEL_COUNT, outputBlock);
+	mixedFrameCount += MIX_BLOCK_FRAMES;
+
+	stats.activeVoiceCount = voiceCount;
+	stats.blockMixMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+bool idSoundMixer::IsSampleValid(const mixSampleId_t &sampleId) const {
+	return (sampleId.index < samples.size()) && samples[sampleId.index].isUsed &&
+		(samples[sampleId.index].generation == sampleId.generation);
+}
+
+void idSoundMixer::RemoveVoice(const unsigned int voiceIndex) {
+	voices[voiceIndex] = voices[--voiceCount];
+}
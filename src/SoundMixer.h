@@ -0,0 +1,138 @@
+#ifndef __SOUND_MIXER__
+#define __SOUND_MIXER__
+
+#include <OpenAL/al.h>
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "SoundUtils.h"
+#include "SpscQueue.h"
+
+struct mixerStats_t {
+	unsigned int activeVoiceCount;
+	unsigned int peakActiveVoiceCount;
+	unsigned int droppedVoiceCount; // Oldest voices cut to play new ones when every voice is in use
+	unsigned int underrunCount; // Times the output source ran out of mixed blocks
+	unsigned int lateScheduleCount; // Scheduled samples whose start frame was already mixed when they were received
+	float blockMixMicroseconds; // Time spent mixing the latest block
+};
+
+// Handle of a mixer sample, the generation tells it apart from samples later added at the same index
+struct mixSampleId_t {
+	uint32_t index;
+	uint32_t generation;
+};
+
+// Mixes short sounds (keysounds) in software and plays the result through a single OpenAL source,
+// so many of them can play at once without using a source each
+class idSoundMixer {
+	public:
+		idSoundMixer();
+		~idSoundMixer();
+
+		// Must be called once the OpenAL context is current, the ring of mixed blocks is sized from the
+		// refresh rate of the device when it's known. Without a thread, blocks are only refilled by Pump.
+		bool Start(const int32_t deviceRefreshRate=0, const bool hasThread=true);
+		void Stop();
+		// Refills played blocks on the caller's thread, when the mixer was started without a thread
+		void Pump();
+		// Converts the sound data to the mixer format (resampling it to the mixer rate) and keeps it until it's removed
+		bool AddSample(const wavFormat_t &format, const char* const soundData, const uint32_t soundDataSize, mixSampleId_t &sampleId);
+		// Pending commands for the sample are ignored, even if its index is reused
+		void RemoveSample(const mixSampleId_t &sampleId);
+		// Sample is mixed into the next refilled block, so it's heard once the blocks already queued are played
+		// (see GetQueuedSeconds, called by the game thread only)
+		bool Play(const mixSampleId_t &sampleId, const float gain=1.0f);
+		// Sample starts on the frame the source plays at that time, if it isn't already mixed
+		// (it must be scheduled more than the queued blocks ahead, called by the game thread only)
+		bool PlayAt(const mixSampleId_t &sampleId, const std::chrono::steady_clock::time_point &startTime, const float gain=1.0f);
+		bool StopSample(const mixSampleId_t &sampleId);
+		mixerStats_t GetStats();
+		// Source playing the mixed output (0 if the mixer isn't started)
+		ALuint GetSource() const;
+		// Delay added by the mixed blocks queued ahead of the one being played
+		float GetQueuedSeconds() const;
+	private:
+		static const int32_t MIX_SAMPLE_RATE = 44100;
+		static const unsigned int MIX_CHANNEL_COUNT = 2;
+		static const unsigned int MIX_BLOCK_FRAMES = 256; // About 5.8ms, must be a multiple of 4 for SIMD mixing
+		// The ring covers two device updates and the feeding delay, within these limits
+		static const unsigned int MIN_MIX_BUFFER_COUNT = 3;
+		static const unsigned int MAX_MIX_BUFFER_COUNT = 32;
+		static const unsigned int DEFAULT_MIX_BUFFER_COUNT = 8; // When the device refresh rate is unknown
+		static const unsigned int MAX_MIX_VOICE_COUNT = 64;
+		static const size_t COMMAND_QUEUE_SIZE = 256;
+		// Delay between two checks for played blocks, must stay well below the duration of a block
+		// (the system timer resolution is raised while the mixer runs, so sleeps last about this long)
+		static const unsigned int MIX_INTERVAL_MS = 1;
+		// The frame clock follows the measured play position slowly, and jumps to it after an underrun
+		static const float CLOCK_SMOOTHING;
+		static const float CLOCK_RESYNC_SECONDS;
+
+		struct mixSample_t {
+			std::vector<int16_t> frames; // Interleaved stereo, padded with silence to a multiple of 4 frames
+			uint32_t generation; // Incremented when the sample is removed
+			bool isUsed;
+		};
+
+		struct mixVoice_t {
+			uint32_t sampleIndex;
+			uint32_t position; // Next frame to mix
+			uint64_t startFrame; // Mixer frame the sample starts on, voices wait until it's mixed
+			float gain;
+		};
+
+		struct mixCommand_t {
+			enum class type_t {
+				PLAY,
+				STOP
+			};
+			type_t type;
+			mixSampleId_t sampleId;
+			float gain;
+			bool isScheduled;
+			std::chrono::steady_clock::time_point startTime; // Only used by scheduled commands
+		};
+
+		ALuint source;
+		std::vector<ALuint> buffers;
+		std::vector<mixSample_t> samples;
+		std::vector<uint32_t> freeSampleIndices;
+		mixVoice_t voices[MAX_MIX_VOICE_COUNT];
+		unsigned int voiceCount;
+		mixerStats_t stats;
+		uint64_t mixedFrameCount; // Mixer frame the next mixed block starts on
+		// The source plays frame clockFrame at clockTime, other frames follow at the mixer rate
+		bool isClockSet;
+		uint64_t clockFrame;
+		std::chrono::steady_clock::time_point clockTime;
+		float mixBuffer[MIX_BLOCK_FRAMES * MIX_CHANNEL_COUNT];
+		int16_t outputBlock[MIX_BLOCK_FRAMES * MIX_CHANNEL_COUNT];
+
+		idSpscQueue<mixCommand_t, COMMAND_QUEUE_SIZE> commands;
+		std::thread mixThread;
+		std::atomic<bool> shouldStop;
+		std::mutex mixMutex; // Protects samples, voices and the source between the mixer thread and callers
+
+		void MixLoop();
+		// Applies pending commands, refills and queues played buffers, restarts the source if it ran dry
+		void Feed();
+		void ApplyCommands();
+		// Measures which frame the source is playing
+		void UpdateClock();
+		uint64_t GetFrameForTime(const std::chrono::steady_clock::time_point &time) const;
+		// Mixes active voices into the output block
+		void MixBlock();
+		bool IsSampleValid(const mixSampleId_t &sampleId) const;
+		void RemoveVoice(const unsigned int voiceIndex);
+
+		idSoundMixer(const idSoundMixer &other) = delete;
+		idSoundMixer& operator=(const idSoundMixer &other) = delete;
+};
+
+#endif
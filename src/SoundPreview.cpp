@@ -0,0 +1,127 @@
+#include "SoundPreview.h"
+
+const float idSoundPreview::FADE_SECONDS = 0.5f;
+const unsigned int idSoundPreview::UPDATE_INTERVAL_MS;
+
+idSoundPreview::idSoundPreview()
+: stream()
+, outputSampleRate(0)
+, isStreamOpen(false)
+, gain(0.0f)
+, currentRequest()
+, pendingRequest()
+, hasPendingRequest(false)
+, shouldStop(false) {}
+
+idSoundPreview::~idSoundPreview() {
+	Stop();
+}
+
+void idSoundPreview::Start(const int32_t _outputSampleRate) {
+	if (previewThread.joinable()) {
+		return;
+	}
+	outputSampleRate = _outputSampleRate;
+
+	shouldStop = false;
+	previewThread = std::thread(&idSoundPreview::PreviewLoop, this);
+}
+
+void idSoundPreview::Stop() {
+	if (previewThread.joinable()) {
+		shouldStop = true;
+		previewThread.join();
+	}
+
+	stream.Close();
+	isStreamOpen = false;
+	hasPendingRequest = false;
+}
+
+void idSoundPreview::Play(const std::string &fileName, const float startSeconds, const float durationSeconds) {
+	std::lock_guard<std::mutex> lock(requestMutex);
+	pendingRequest.fileName = fileName;
+	pendingRequest.startSeconds = startSeconds;
+	pendingRequest.durationSeconds = durationSeconds;
+	hasPendingRequest = true;
+}
+
+void idSoundPreview::FadeOut() {
+	Play("", 0.0f, 0.0f);
+}
+
+void idSoundPreview::PreviewLoop() {
+	const float fadeStep = float(UPDATE_INTERVAL_MS) / (1000.0f * FADE_SECONDS);
+	while (!shouldStop) {
+		Update(fadeStep);
+		std::this_thread::sleep_for(std::chrono::milliseconds(UPDATE_INTERVAL_MS));
+	}
+}
+
+void idSoundPreview::Update(const float fadeStep) {
+	bool hasRequest;
+	{
+		std::lock_guard<std::mutex> lock(requestMutex);
+		hasRequest = hasPendingRequest;
+	}
+
+	// Requests made while fading out replace each other, only the latest one is opened
+	if (hasRequest) {
+		if (isStreamOpen && (gain > 0.0f)) {
+			gain = (gain > fadeStep) ? (gain - fadeStep) : 0.0f;
+			stream.SetGain(gain);
+			return;
+		}
+
+		request_t request;
+		{
+			std::lock_guard<std::mutex> lock(requestMutex);
+			request = pendingRequest;
+			hasPendingRequest = false;
+		}
+		OpenRequest(request);
+		return;
+	}
+
+	if (!isStreamOpen) {
+		return;
+	}
+
+	// Loop the excerpt, fading in after its start and out before its end
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	float elapsedSeconds = std::chrono::duration<float>(now - playStartTime).count();
+	if (elapsedSeconds >= currentRequest.durationSeconds) {
+		// The stream stops by itself if the excerpt ran past the end of the song
+		stream.SetPlaybackPosition(currentRequest.startSeconds);
+		stream.Resume();
+		playStartTime = now;
+		elapsedSeconds = 0.0f;
+	}
+	if (elapsedSeconds < currentRequest.durationSeconds - FADE_SECONDS) {
+		gain = (gain + fadeStep < 1.0f) ? (gain + fadeStep) : 1.0f;
+	} else {
+		gain = (gain > fadeStep) ? (gain - fadeStep) : 0.0f;
+	}
+	stream.SetGain(gain);
+}
+
+void idSoundPreview::OpenRequest(const request_t &request) {
+	stream.Close();
+	isStreamOpen = false;
+	if (request.fileName.empty()) {
+		return;
+	}
+
+	// Previews don't need the precision of float samples, 16-bit ones halve the ring size
+	if (!stream.Open(request.fileName, false, true, PREVIEW_BUFFER_SIZE, outputSampleRate)) {
+		return;
+	}
+	gain = 0.0f;
+	stream.SetGain(gain);
+	stream.SetPlaybackPosition(request.startSeconds);
+	stream.Resume();
+
+	isStreamOpen = true;
+	currentRequest = request;
+	playStartTime = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,61 @@
+#ifndef __SOUND_PREVIEW__
+#define __SOUND_PREVIEW__
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "SoundStream.h"
+
+// Plays an excerpt of a song in a loop, streamed through a small buffer ring and faded in and out.
+// Files are opened by a worker thread, so changing the previewed song never waits for the disk.
+class idSoundPreview {
+	public:
+		idSoundPreview();
+		~idSoundPreview();
+
+		// Must be called once the OpenAL context is current, previews are resampled to the output rate if one is given
+		void Start(const int32_t _outputSampleRate=0);
+		void Stop();
+		// The current preview fades out before the new one is opened, only the latest request is kept
+		void Play(const std::string &fileName, const float startSeconds, const float durationSeconds);
+		// Fades out and closes the current preview
+		void FadeOut();
+	private:
+		// Each of the stream buffers holds about 93ms of 44.1kHz stereo 16-bit sound
+		static const uint32_t PREVIEW_BUFFER_SIZE = 16 * 1024;
+		static const float FADE_SECONDS;
+		static const unsigned int UPDATE_INTERVAL_MS = 10;
+
+		struct request_t {
+			std::string fileName; // Empty to stop the preview
+			float startSeconds;
+			float durationSeconds;
+		};
+
+		idSoundStream stream;
+		int32_t outputSampleRate;
+		bool isStreamOpen;
+		float gain;
+		request_t currentRequest;
+		std::chrono::steady_clock::time_point playStartTime;
+
+		request_t pendingRequest;
+		bool hasPendingRequest;
+		std::mutex requestMutex; // Protects the pending request between the worker and callers
+
+		std::thread previewThread;
+		std::atomic<bool> shouldStop;
+
+		void PreviewLoop();
+		// Opens the requested file once the current preview has faded out
+		void Update(const float fadeStep);
+		void OpenRequest(const request_t &request);
+
+		idSoundPreview(const idSoundPreview &other) = delete;
+		idSoundPreview& operator=(const idSoundPreview &other) = delete;
+};
+
+#endif
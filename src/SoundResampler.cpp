@@ -0,0 +1,235 @@
+#include <cmath>
+#include <algorithm>
+
+#include "SoundResampler.h"
+
+// SSE2 is always available on x86 and x64 Windows targets
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOUND_RESAMPLER_SSE2
+#endif
+
+static const double PI = 3.14159265358979323846;
+// Frames converted at once when resampling whole sounds
+static const size_t RESAMPLE_CHUNK_FRAMES = 4096;
+
+const uint32_t idSoundResampler::MAX_PHASE_COUNT;
+const uint32_t idSoundResampler::BASE_TAP_COUNT;
+const uint32_t idSoundResampler::MAX_TAP_COUNT;
+const double idSoundResampler::CUTOFF_RATIO = 0.9;
+
+static uint32_t GreatestCommonDivisor(uint32_t a, uint32_t b) {
+	while (b != 0) {
+		const uint32_t remainder = a % b;
+		a = b;
+		b = remainder;
+	}
+	return a;
+}
+
+// count must be a multiple of 4
+static float DotProduct(const float* const a, const float* const b, const uint32_t count) {
+#ifdef SOUND_RESAMPLER_SSE2
+	__m128 sum = _mm_setzero_ps();
+	for (uint32_t i = 0; i < count; i += 4) {
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+	return _mm_cvtss_f32(sum);
+#else
+	float sums[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (uint32_t i = 0; i < count; i += 4) {
+		sums[0] += a[i] * b[i];
+		sums[1] += a[i + 1] * b[i + 1];
+		sums[2] += a[i + 2] * b[i + 2];
+		sums[3] += a[i + 3] * b[i + 3];
+	}
+	return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+#endif
+}
+
+idSoundResampler::idSoundResampler()
+: upFactor(1)
+, downFactor(1)
+, tapCount(0)
+, channelCount(0)
+, coefficients()
+, historyStart(0)
+, phase(0)
+, inputFrameTotal(0)
+, outputFrameTotal(0) {}
+
+bool idSoundResampler::IsSupported(const int32_t inputRate, const int32_t outputRate, const int32_t channelCount) {
+	if ((inputRate <= 0) || (outputRate <= 0) || (channelCount < 1) || (channelCount > 2)) {
+		return false;
+	}
+	return (uint32_t(outputRate) / GreatestCommonDivisor(uint32_t(inputRate), uint32_t(outputRate))) <= MAX_PHASE_COUNT;
+}
+
+bool idSoundResampler::Init(const int32_t inputRate, const int32_t outputRate, const int32_t _channelCount) {
+	if (!IsSupported(inputRate, outputRate, _channelCount)) {
+		return false;
+	}
+	const uint32_t divisor = GreatestCommonDivisor(uint32_t(inputRate), uint32_t(outputRate));
+	upFactor = uint32_t(outputRate) / divisor;
+	downFactor = uint32_t(inputRate) / divisor;
+	channelCount = _channelCount;
+
+	// Downsampling lowers the cutoff below the output Nyquist frequency, the filter gets longer to stay as steep
+	const double scale = (std::min)(1.0, double(upFactor) / double(downFactor));
+	tapCount = uint32_t(std::ceil(double(BASE_TAP_COUNT) / scale));
+	tapCount = (std::min)((tapCount + 3) & ~uint32_t(3), MAX_TAP_COUNT);
+	const double halfTapCount = double(tapCount / 2);
+	const double cutoff = 0.5 * CUTOFF_RATIO * scale; // In cycles per input frame
+
+	// Phase p holds the Blackman-windowed sinc taken at the distances between the input frames and the
+	// position of the output, p / upFactor frames after the center frame
+	coefficients.resize(size_t(upFactor) * tapCount);
+	for (uint32_t p = 0; p < upFactor; ++p) {
+		float* const phaseCoefficients = &coefficients[size_t(p) * tapCount];
+		double sum = 0.0;
+		for (uint32_t k = 0; k < tapCount; ++k) {
+			const double distance = double(k) - (halfTapCount - 1.0) - double(p) / double(upFactor);
+			const double sinc = (distance == 0.0) ? (2.0 * cutoff) : (std::sin(2.0 * PI * cutoff * distance) / (PI * distance));
+			const double windowPosition = distance / halfTapCount;
+			const double window = (std::abs(windowPosition) >= 1.0) ? 0.0 :
+				(0.42 + 0.5 * std::cos(PI * windowPosition) + 0.08 * std::cos(2.0 * PI * windowPosition));
+			phaseCoefficients[k] = float(sinc * window);
+			sum += sinc * window;
+		}
+		// Each phase has a unit gain, so constant signals stay constant
+		for (uint32_t k = 0; k < tapCount; ++k) {
+			phaseCoefficients[k] = float(double(phaseCoefficients[k]) / sum);
+		}
+	}
+
+	Reset();
+	return true;
+}
+
+void idSoundResampler::Reset() {
+	// The first output is centered on the first input frame, the taps before it read silence
+	for (int32_t channel = 0; channel < 2; ++channel) {
+		history[channel].assign((channel < channelCount) ? (tapCount / 2 - 1) : 0, 0.0f);
+	}
+	historyStart = 0;
+	phase = 0;
+	inputFrameTotal = 0;
+	outputFrameTotal = 0;
+}
+
+size_t idSoundResampler::GetMaxOutputFrameCount(const size_t inputFrameCount) const {
+	return size_t((uint64_t(inputFrameCount) + tapCount) * upFactor / downFactor) + 2;
+}
+
+size_t idSoundResampler::Process(const float* const input, const size_t inputFrameCount, float* const output) {
+	for (int32_t channel = 0; channel < channelCount; ++channel) {
+		std::vector<float> &channelHistory = history[channel];
+		const size_t previousSize = channelHistory.size();
+		channelHistory.resize(previousSize + inputFrameCount);
+		for (size_t i = 0; i < inputFrameCount; ++i) {
+			channelHistory[previousSize + i] = input[i * size_t(channelCount) + size_t(channel)];
+		}
+	}
+	inputFrameTotal += inputFrameCount;
+
+	const size_t writtenCount = Filter(output, UINT64_MAX);
+
+	// Drop the frames no output needs anymore
+	const size_t droppedCount = (std::min)(historyStart, history[0].size());
+	for (int32_t channel = 0; channel < channelCount; ++channel) {
+		history[channel].erase(history[channel].begin(), history[channel].begin() + droppedCount);
+	}
+	historyStart -= droppedCount;
+
+	return writtenCount;
+}
+
+size_t idSoundResampler::Flush(float* const output) {
+	// Silence after the sound lets the filter reach its last frames
+	for (int32_t channel = 0; channel < channelCount; ++channel) {
+		history[channel].resize(history[channel].size() + tapCount, 0.0f);
+	}
+	const uint64_t totalFrameCount = GetOutputFrameCount(inputFrameTotal, int32_t(downFactor), int32_t(upFactor));
+	const size_t writtenCount = Filter(output, totalFrameCount - outputFrameTotal);
+
+	Reset();
+	return writtenCount;
+}
+
+uint64_t idSoundResampler::GetOutputFrameCount(const uint64_t inputFrameCount, const int32_t inputRate, const int32_t outputRate) {
+	return (inputFrameCount * uint64_t(outputRate) + uint64_t(inputRate) - 1) / uint64_t(inputRate);
+}
+
+size_t idSoundResampler::Filter(float* const output, const uint64_t maxFrameCount) {
+	size_t writtenCount = 0;
+	const size_t historySize = history[0].size();
+	while ((writtenCount < maxFrameCount) && (historyStart + tapCount <= historySize)) {
+		const float* const phaseCoefficients = &coefficients[size_t(phase) * tapCount];
+		for (int32_t channel = 0; channel < channelCount; ++channel) {
+			output[writtenCount * size_t(channelCount) + size_t(channel)] = DotProduct(phaseCoefficients, &history[channel][historyStart], tapCount);
+		}
+		++writtenCount;
+
+		phase += downFactor;
+		historyStart += phase / upFactor;
+		phase %= upFactor;
+	}
+
+	outputFrameTotal += writtenCount;
+	return writtenCount;
+}
+
+bool ResampleSoundData(
+	const char* const data,
+	const size_t dataSize,
+	const sampleType_t sampleType,
+	const int32_t channelCount,
+	const int32_t inputRate,
+	const int32_t outputRate,
+	const sampleType_t destinationType,
+	ditherState_t* const ditherState,
+	std::vector<char> &resampled) {
+	if (((sampleType != sampleType_t::UINT8) && (sampleType != sampleType_t::INT16) && (sampleType != sampleType_t::FLOAT32)) ||
+		((destinationType != sampleType_t::INT16) && (destinationType != sampleType_t::FLOAT32))) {
+		return false;
+	}
+	idSoundResampler resampler;
+	if (!resampler.Init(inputRate, outputRate, channelCount)) {
+		return false;
+	}
+
+	const size_t frameSize = GetSampleTypeSize(sampleType) * size_t(channelCount);
+	const size_t destinationFrameSize = GetSampleTypeSize(destinationType) * size_t(channelCount);
+	const size_t frameCount = dataSize / frameSize;
+	resampled.resize(size_t(idSoundResampler::GetOutputFrameCount(frameCount, inputRate, outputRate)) * destinationFrameSize);
+
+	// Frames go through floats a chunk at a time, the last chunk being followed by the flushed frames
+	std::vector<float> inputFloats(RESAMPLE_CHUNK_FRAMES * size_t(channelCount));
+	std::vector<float> outputFloats(resampler.GetMaxOutputFrameCount(RESAMPLE_CHUNK_FRAMES) * size_t(channelCount));
+	size_t writtenCount = 0;
+	for (size_t frame = 0; frame < frameCount + RESAMPLE_CHUNK_FRAMES; frame += RESAMPLE_CHUNK_FRAMES) {
+		size_t producedCount;
+		if (frame < frameCount) {
+			const size_t chunkFrameCount = (std::min)(RESAMPLE_CHUNK_FRAMES, frameCount - frame);
+			ConvertSamples(data + frame * frameSize, sampleType, chunkFrameCount * size_t(channelCount),
+				reinterpret_cast<char*>(&inputFloats[0]), sampleType_t::FLOAT32, nullptr);
+			producedCount = resampler.Process(&inputFloats[0], chunkFrameCount, &outputFloats[0]);
+		} else {
+			producedCount = resampler.Flush(&outputFloats[0]);
+		}
+		if (producedCount == 0) {
+			continue;
+		}
+		if (writtenCount + producedCount > resampled.size() / destinationFrameSize) {
+			return false;
+		}
+		ConvertSamples(reinterpret_cast<const char*>(&outputFloats[0]), sampleType_t::FLOAT32, producedCount * size_t(channelCount),
+			&resampled[writtenCount * destinationFrameSize], destinationType, ditherState);
+		writtenCount += producedCount;
+	}
+
+	resampled.resize(writtenCount * destinationFrameSize);
+	return true;
+}
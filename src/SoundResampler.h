@@ -0,0 +1,67 @@
+#ifndef __SOUND_RESAMPLER__
+#define __SOUND_RESAMPLER__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "SoundUtils.h"
+
+// Converts interleaved float frames between two sample rates with a polyphase windowed-sinc filter.
+// Output frame n is taken at input position n * inputRate / outputRate, so positions stay exact, and the
+// filter state is kept between calls so a sound can be resampled a chunk at a time.
+class idSoundResampler {
+	public:
+		idSoundResampler();
+
+		// The rates must reduce to a ratio of at most MAX_PHASE_COUNT output frames per period (any pair of usual rates does)
+		static bool IsSupported(const int32_t inputRate, const int32_t outputRate, const int32_t channelCount);
+		bool Init(const int32_t inputRate, const int32_t outputRate, const int32_t _channelCount);
+		// Drops the frames held by the filter, as when starting a new sound
+		void Reset();
+		// Upper bound of the frames written by Process (or Flush) for inputFrameCount more input frames
+		size_t GetMaxOutputFrameCount(const size_t inputFrameCount) const;
+		// Returns the number of frames written, the latest input frames are held back by the filter until
+		// more input comes or Flush is called
+		size_t Process(const float* const input, const size_t inputFrameCount, float* const output);
+		// Writes the frames held back at the end of the sound, then starts over
+		size_t Flush(float* const output);
+		// Frame count of a whole sound once resampled
+		static uint64_t GetOutputFrameCount(const uint64_t inputFrameCount, const int32_t inputRate, const int32_t outputRate);
+	private:
+		static const uint32_t MAX_PHASE_COUNT = 1024;
+		// Taps of each phase when upsampling, more are used when downsampling so the cutoff can be lowered
+		static const uint32_t BASE_TAP_COUNT = 32;
+		static const uint32_t MAX_TAP_COUNT = 128;
+		// Cutoff frequency relative to the lower of the two Nyquist frequencies
+		static const double CUTOFF_RATIO;
+
+		uint32_t upFactor; // Phases of the filter, output frames per period
+		uint32_t downFactor; // Input frames per period
+		uint32_t tapCount; // A multiple of 4 for SIMD dot products
+		int32_t channelCount;
+		std::vector<float> coefficients; // tapCount coefficients per phase
+		std::vector<float> history[2]; // Input frames of each channel not yet fully used
+		size_t historyStart; // Frame of the history where the taps of the next output start
+		uint32_t phase;
+		uint64_t inputFrameTotal;
+		uint64_t outputFrameTotal;
+
+		// Writes the outputs whose taps are all in the history (up to maxFrameCount of them)
+		size_t Filter(float* const output, const uint64_t maxFrameCount);
+};
+
+// Resamples whole sound data of 8-bit, 16-bit or float samples to destinationType samples (INT16 or FLOAT32,
+// dither noise is added when they are reduced to 16 bits if a dither state is given)
+bool ResampleSoundData(
+	const char* const data,
+	const size_t dataSize,
+	const sampleType_t sampleType,
+	const int32_t channelCount,
+	const int32_t inputRate,
+	const int32_t outputRate,
+	const sampleType_t destinationType,
+	ditherState_t* const ditherState,
+	std::vector<char> &resampled);
+
+#endif
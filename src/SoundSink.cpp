@@ -0,0 +1,181 @@
+#include <chrono>
+#include <algorithm>
+
+#include "SoundSink.h"
+
+const unsigned int idSoundSink::RENDER_INTERVAL_MS;
+
+// Writes the lowest byteCount bytes of the value, least significant first
+static void WriteLittleEndian(std::ofstream &file, const uint32_t value, const unsigned int byteCount) {
+	for (unsigned int i = 0; i < byteCount; ++i) {
+		file.put(char((value >> (i * 8)) & 0xFF));
+	}
+}
+
+idSoundSink::idSoundSink()
+: device(NULL)
+, renderSamples(nullptr)
+, renderBlock()
+, writtenDataSize(0)
+, clock(sinkClock_t::SYSTEM)
+, virtualClockSeconds(0.0)
+, shouldStop(false)
+, renderedFrameCount(0) {
+	contextAttributes[0] = ALC_FORMAT_CHANNELS_SOFT;
+	contextAttributes[1] = ALC_STEREO_SOFT;
+	contextAttributes[2] = ALC_FORMAT_TYPE_SOFT;
+	contextAttributes[3] = ALC_SHORT_SOFT;
+	contextAttributes[4] = ALC_FREQUENCY;
+	contextAttributes[5] = SINK_SAMPLE_RATE;
+	contextAttributes[6] = 0;
+}
+
+idSoundSink::~idSoundSink() {
+	Stop();
+}
+
+bool idSoundSink::Open(const std::string &fileName) {
+	if (!alcIsExtensionPresent(NULL, "ALC_SOFT_loopback")) {
+		return false;
+	}
+	LPALCLOOPBACKOPENDEVICESOFT loopbackOpenDevice = reinterpret_cast<LPALCLOOPBACKOPENDEVICESOFT>(alcGetProcAddress(NULL, "alcLoopbackOpenDeviceSOFT"));
+	LPALCISRENDERFORMATSUPPORTEDSOFT isRenderFormatSupported = reinterpret_cast<LPALCISRENDERFORMATSUPPORTEDSOFT>(alcGetProcAddress(NULL, "alcIsRenderFormatSupportedSOFT"));
+	renderSamples = reinterpret_cast<LPALCRENDERSAMPLESSOFT>(alcGetProcAddress(NULL, "alcRenderSamplesSOFT"));
+	if ((loopbackOpenDevice == nullptr) || (isRenderFormatSupported == nullptr) || (renderSamples == nullptr)) {
+		return false;
+	}
+
+	device = loopbackOpenDevice(NULL);
+	if (device == NULL) {
+		return false;
+	}
+	if (!isRenderFormatSupported(device, SINK_SAMPLE_RATE, ALC_STEREO_SOFT, ALC_SHORT_SOFT)) {
+		alcCloseDevice(device);
+		device = NULL;
+		return false;
+	}
+
+	// Sizes in the header are completed when the sink stops
+	if (!fileName.empty()) {
+		file.open(fileName, std::ios_base::binary | std::ios_base::trunc);
+		if (!file.is_open()) {
+			alcCloseDevice(device);
+			device = NULL;
+			return false;
+		}
+		WriteWavHeader(0);
+	}
+
+	return true;
+}
+
+const ALCint* idSoundSink::GetContextAttributes() const {
+	return contextAttributes;
+}
+
+ALCdevice* idSoundSink::GetDevice() const {
+	return device;
+}
+
+bool idSoundSink::Start(const sinkClock_t _clock) {
+	if ((device == NULL) || renderThread.joinable()) {
+		return false;
+	}
+
+	renderBlock.assign(RENDER_BLOCK_FRAMES * SINK_CHANNEL_COUNT, 0);
+	renderedFrameCount = 0;
+	clock = _clock;
+	virtualClockSeconds = 0.0;
+	if (clock == sinkClock_t::SYSTEM) {
+		shouldStop = false;
+		renderThread = std::thread(&idSoundSink::RenderLoop, this);
+	}
+	return true;
+}
+
+void idSoundSink::Stop() {
+	if (renderThread.joinable()) {
+		shouldStop = true;
+		renderThread.join();
+	}
+
+	if (file.is_open()) {
+		file.seekp(0);
+		WriteWavHeader(writtenDataSize);
+		file.close();
+	}
+
+	// The device itself is closed by its owner, along with its context
+	device = NULL;
+}
+
+void idSoundSink::AdvanceClock(const double seconds, const std::function<void(void)> &feedFunc) {
+	if ((device == NULL) || (clock != sinkClock_t::VIRTUAL) || (seconds <= 0.0)) {
+		return;
+	}
+
+	// Due frames are counted from the total time, so fractions of frames aren't lost between calls
+	virtualClockSeconds += seconds;
+	RenderFrames(uint64_t(virtualClockSeconds * double(SINK_SAMPLE_RATE)), feedFunc);
+}
+
+sinkClock_t idSoundSink::GetClock() const {
+	return clock;
+}
+
+uint64_t idSoundSink::GetRenderedFrameCount() const {
+	return renderedFrameCount;
+}
+
+void idSoundSink::RenderLoop() {
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	while (!shouldStop) {
+		// Render every block due by now, so the rendered time follows the clock even if a wake up is late
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+		const uint64_t dueFrameCount = uint64_t(elapsed.count() * double(SINK_SAMPLE_RATE));
+		// Only whole blocks are rendered, the rest is rendered with the next ones
+		RenderFrames(dueFrameCount - dueFrameCount % RENDER_BLOCK_FRAMES, nullptr);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(RENDER_INTERVAL_MS));
+	}
+}
+
+void idSoundSink::RenderFrames(const uint64_t dueFrameCount, const std::function<void(void)> &feedFunc) {
+	while (renderedFrameCount < dueFrameCount) {
+		if (feedFunc) {
+			feedFunc();
+		}
+		const ALCsizei frameCount = ALCsizei((std::min)(dueFrameCount - renderedFrameCount, uint64_t(RENDER_BLOCK_FRAMES)));
+		renderSamples(device, &renderBlock[0], frameCount);
+		renderedFrameCount += uint64_t(frameCount);
+
+		if (file.is_open()) {
+			const uint32_t blockSize = uint32_t(frameCount * SINK_CHANNEL_COUNT * sizeof(int16_t));
+			file.write(reinterpret_cast<const char*>(&renderBlock[0]), blockSize);
+			writtenDataSize += blockSize;
+		}
+	}
+}
+
+void idSoundSink::WriteWavHeader(const uint32_t dataSize) {
+	static const uint32_t FMT_CHUNK_SIZE = 16;
+	static const uint32_t PCM_FORMAT = 1;
+	static const uint32_t BITS_PER_SAMPLE = 16;
+	const uint32_t blockAlign = SINK_CHANNEL_COUNT * (BITS_PER_SAMPLE / 8);
+
+	file.write("RIFF", 4);
+	WriteLittleEndian(file, 4 + (8 + FMT_CHUNK_SIZE) + (8 + dataSize), 4);
+	file.write("WAVE", 4);
+
+	file.write("fmt ", 4);
+	WriteLittleEndian(file, FMT_CHUNK_SIZE, 4);
+	WriteLittleEndian(file, PCM_FORMAT, 2);
+	WriteLittleEndian(file, SINK_CHANNEL_COUNT, 2);
+	WriteLittleEndian(file, uint32_t(SINK_SAMPLE_RATE), 4);
+	WriteLittleEndian(file, uint32_t(SINK_SAMPLE_RATE) * blockAlign, 4);
+	WriteLittleEndian(file, blockAlign, 2);
+	WriteLittleEndian(file, BITS_PER_SAMPLE, 2);
+
+	file.write("data", 4);
+	WriteLittleEndian(file, dataSize, 4);
+}
@@ -0,0 +1,77 @@
+#ifndef __SOUND_SINK__
+#define __SOUND_SINK__
+
+#include <OpenAL/al.h>
+#include <OpenAL/alc.h>
+#include <OpenAL/alext.h>
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+enum class sinkClock_t {
+	SYSTEM, // Rendered by a thread at the pace of the system clock, as a real device would
+	VIRTUAL // Rendered on the caller's thread only when the clock is advanced, possibly faster than real time
+	        // (sources must then be fed by the caller rather than by threads, see AdvanceClock)
+};
+
+// Renders the output of an OpenAL loopback device in place of a sound card, so that sources advance
+// as they would on a real device. The rendered samples are dropped, or written to a WAV file when a
+// file name is given.
+class idSoundSink {
+	public:
+		idSoundSink();
+		~idSoundSink();
+
+		// Opens the loopback device (an empty file name drops the output), requires ALC_SOFT_loopback
+		bool Open(const std::string &fileName);
+		// Attribute list the context of the device must be created with
+		const ALCint* GetContextAttributes() const;
+		ALCdevice* GetDevice() const;
+		// Must be called once the context of the device is current
+		bool Start(const sinkClock_t _clock=sinkClock_t::SYSTEM);
+		// Must be called before the context is destroyed, completes the WAV file
+		void Stop();
+		// Renders every frame due once the virtual clock moved forward, does nothing on the system clock.
+		// feedFunc is called before each rendered block to refill the sources, so they don't run dry
+		// however fast the clock is moved.
+		void AdvanceClock(const double seconds, const std::function<void(void)> &feedFunc);
+		sinkClock_t GetClock() const;
+		// Frames rendered since Start
+		uint64_t GetRenderedFrameCount() const;
+	private:
+		static const ALCint SINK_SAMPLE_RATE = 44100;
+		static const unsigned int SINK_CHANNEL_COUNT = 2;
+		static const unsigned int RENDER_BLOCK_FRAMES = 256;
+		// Delay between two renderings, rendering catches up with the clock after it
+		static const unsigned int RENDER_INTERVAL_MS = 5;
+
+		ALCdevice* device;
+		LPALCRENDERSAMPLESSOFT renderSamples;
+		ALCint contextAttributes[7];
+		std::ofstream file;
+		std::vector<int16_t> renderBlock;
+		uint32_t writtenDataSize;
+
+		sinkClock_t clock;
+		double virtualClockSeconds;
+		std::thread renderThread;
+		std::atomic<bool> shouldStop;
+		std::atomic<uint64_t> renderedFrameCount;
+
+		void RenderLoop();
+		// Renders frames until the count reaches dueFrameCount, in blocks of at most RENDER_BLOCK_FRAMES
+		// (calling feedFunc before each one if it's set)
+		void RenderFrames(const uint64_t dueFrameCount, const std::function<void(void)> &feedFunc);
+		// Writes the header of a 16-bit PCM WAV file holding dataSize bytes of samples
+		void WriteWavHeader(const uint32_t dataSize);
+
+		idSoundSink(const idSoundSink &other) = delete;
+		idSoundSink& operator=(const idSoundSink &other) = delete;
+};
+
+#endif
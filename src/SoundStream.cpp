@@ -0,0 +1,385 @@
+#include <chrono>
+#include <algorithm>
+
+#include "SoundUtils.h"
+#include "SoundStream.h"
+
+const unsigned int idSoundStream::FEED_INTERVAL_MS;
+
+idSoundStream::idSoundStream()
+: source(0)
+, freeBuffers()
+, readBuffer()
+, convertBuffer()
+, isResampled(false)
+, resampler()
+, bufferSampleRate(0)
+, resampleInput()
+, resampleOutput()
+, resampleBuffer()
+, format(AL_NONE)
+, sampleType(sampleType_t::INT16)
+, bufferSampleType(sampleType_t::INT16)
+, isDithered(false)
+, fileFormat()
+, dataOffset(0)
+, dataSize(0)
+, readPosition(0)
+, isRepeating(false)
+, isPlaying(false)
+, isAtStart(false)
+, isEndQueued(false)
+, isSeekPending(false)
+, seekPosition(0)
+, seekCount(0)
+, shouldStop(false) {
+	for (unsigned int i = 0; i < STREAM_BUFFER_COUNT; ++i) {
+		buffers[i] = 0;
+	}
+}
+
+idSoundStream::~idSoundStream() {
+	Close();
+}
+
+bool idSoundStream::Open(const std::string &fileName, const bool isFloatSupported, const bool _isDithered, const uint32_t bufferSize, const int32_t outputSampleRate, const bool hasFeedThread) {
+	Close();
+
+	if (!OpenWavFile(fileName, file, fileFormat, dataSize) ||
+		!GetWavBufferFormat(fileFormat, isFloatSupported, format, bufferSampleType) ||
+		!GetWavSampleType(fileFormat, sampleType) ||
+		(dataSize <= 0)) {
+		file.close();
+		return false;
+	}
+	dataOffset = file.tellg();
+
+	// Prepare source and buffer ring
+	alGenSources(1, &source);
+	if (alGetError() != AL_NO_ERROR) {
+		source = 0;
+		file.close();
+		return false;
+	}
+	alGenBuffers(STREAM_BUFFER_COUNT, buffers);
+	if (alGetError() != AL_NO_ERROR) {
+		alDeleteSources(1, &source);
+		source = 0;
+		file.close();
+		return false;
+	}
+	alSourcef(source, AL_PITCH, 1);
+	alSourcef(source, AL_GAIN, 1.0f);
+	alSource3f(source, AL_POSITION, 0, 0, 0);
+	alSource3f(source, AL_VELOCITY, 0, 0, 0);
+	alSourcei(source, AL_LOOPING, AL_FALSE); // Looping is done when reading the file
+
+	// Reads are aligned on whole blocks (sample frames for PCM), so each one can be decoded on its own
+	readBuffer.resize(bufferSize - (bufferSize % uint32_t(fileFormat.blockAlign)));
+	if (readBuffer.empty()) {
+		Close();
+		return false;
+	}
+	if (bufferSampleType != sampleType) {
+		convertBuffer.resize(GetConvertedWavDataSize(fileFormat, bufferSampleType, readBuffer.size()));
+	}
+
+	// Resampled chunks can hold a few more frames than the read ones, and the flushed ones at the end
+	bufferSampleRate = fileFormat.sampleRate;
+	isResampled = (outputSampleRate > 0) && (outputSampleRate != fileFormat.sampleRate) &&
+		resampler.Init(fileFormat.sampleRate, outputSampleRate, fileFormat.numChannels);
+	if (isResampled) {
+		const sampleType_t resampledType = (bufferSampleType == sampleType_t::FLOAT32) ? sampleType_t::FLOAT32 : sampleType_t::INT16;
+		const size_t channelCount = size_t(fileFormat.numChannels);
+		const size_t readFrameCount = GetConvertedWavDataSize(fileFormat, bufferSampleType, readBuffer.size()) / (channelCount * GetSampleTypeSize(bufferSampleType));
+		const size_t resampledFrameCount = resampler.GetMaxOutputFrameCount(readFrameCount) + resampler.GetMaxOutputFrameCount(0);
+		resampleInput.resize(readFrameCount * channelCount);
+		resampleOutput.resize(resampledFrameCount * channelCount);
+		resampleBuffer.resize(resampledFrameCount * channelCount * GetSampleTypeSize(resampledType));
+		GetBufferFormat(resampledType, fileFormat.numChannels, format);
+		bufferSampleRate = outputSampleRate;
+	}
+	isDithered = _isDithered;
+	InitDitherState(ditherState);
+	freeBuffers.assign(buffers, buffers + STREAM_BUFFER_COUNT);
+	isRepeating = false;
+	isPlaying = false;
+	if (!Seek(0)) {
+		Close();
+		return false;
+	}
+	isAtStart = true;
+	if (!hasFeedThread) {
+		return true;
+	}
+
+	shouldStop = false;
+	feedThread = std::thread(&idSoundStream::FeedLoop, this);
+
+	return true;
+}
+
+void idSoundStream::Close() {
+	if (feedThread.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(streamMutex);
+			shouldStop = true;
+		}
+		feedCondition.notify_one();
+		feedThread.join();
+	}
+
+	if (source != 0) {
+		alSourceStop(source);
+		alSourcei(source, AL_BUFFER, 0);
+		alDeleteSources(1, &source);
+		alDeleteBuffers(STREAM_BUFFER_COUNT, buffers);
+		source = 0;
+	}
+	freeBuffers.clear();
+	for (unsigned int i = 0; i < STREAM_BUFFER_COUNT; ++i) {
+		stagedChunks[i] = std::vector<char>();
+	}
+	readBuffer = std::vector<char>();
+	convertBuffer = std::vector<char>();
+	isResampled = false;
+	resampleInput = std::vector<float>();
+	resampleOutput = std::vector<float>();
+	resampleBuffer = std::vector<char>();
+	file.close();
+	isPlaying = false;
+	isAtStart = false;
+	isEndQueued = false;
+	isSeekPending = false;
+}
+
+bool idSoundStream::Play(const bool repeat) {
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (source == 0) {
+		return false;
+	}
+
+	// Buffers already filled from the start are played as they are, unless they end without the requested loop
+	const bool isReusable = isAtStart && !(repeat && isEndQueued);
+	isRepeating = repeat;
+	if (!isReusable && !Seek(0)) {
+		return false;
+	}
+	isAtStart = false;
+	alSourcePlay(source); // Started by the feeder instead if nothing is queued yet
+	isPlaying = true;
+
+	return alGetError() == AL_NO_ERROR;
+}
+
+bool idSoundStream::Pause() {
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (source == 0) {
+		return false;
+	}
+
+	alSourcePause(source);
+	isPlaying = false;
+
+	return alGetError() == AL_NO_ERROR;
+}
+
+bool idSoundStream::Resume() {
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (source == 0) {
+		return false;
+	}
+
+	alSourcePlay(source);
+	isPlaying = true;
+	isAtStart = false;
+
+	return alGetError() == AL_NO_ERROR;
+}
+
+bool idSoundStream::Stop() {
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (source == 0) {
+		return false;
+	}
+
+	isPlaying = false;
+	if (!Seek(0)) {
+		return false;
+	}
+	isAtStart = true;
+	return true;
+}
+
+bool idSoundStream::SetPlaybackPosition(const float seconds) {
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (source == 0) {
+		return false;
+	}
+
+	// Round down to the start of the block holding the frame (compressed blocks can't be decoded from their middle)
+	const uint64_t frame = (seconds > 0.0f) ? uint64_t(double(seconds) * double(fileFormat.sampleRate)) : 0;
+	const uint64_t position = (frame / uint64_t(fileFormat.framesPerBlock)) * uint64_t(fileFormat.blockAlign);
+	// The feeder restarts the source once the first buffer is queued if it was playing
+	isAtStart = false;
+	return Seek((position < dataSize) ? uint32_t(position) : dataSize);
+}
+
+bool idSoundStream::SetGain(const float gain) {
+	std::lock_guard<std::mutex> lock(streamMutex);
+	if (source == 0) {
+		return false;
+	}
+
+	alSourcef(source, AL_GAIN, gain);
+	return alGetError() == AL_NO_ERROR;
+}
+
+void idSoundStream::Pump() {
+	std::unique_lock<std::mutex> lock(streamMutex);
+	if ((source != 0) && !feedThread.joinable()) {
+		Feed(lock);
+	}
+}
+
+void idSoundStream::FeedLoop() {
+	std::unique_lock<std::mutex> lock(streamMutex);
+	while (!shouldStop) {
+		Feed(lock);
+		feedCondition.wait_for(lock, std::chrono::milliseconds(FEED_INTERVAL_MS), [this]() { return isSeekPending || shouldStop; });
+	}
+}
+
+void idSoundStream::Feed(std::unique_lock<std::mutex> &lock) {
+	// Take back buffers the source is done with
+	ALint processedCount;
+	alGetSourcei(source, AL_BUFFERS_PROCESSED, &processedCount);
+	for (ALint i = 0; i < processedCount; ++i) {
+		ALuint buffer;
+		alSourceUnqueueBuffers(source, 1, &buffer);
+		freeBuffers.push_back(buffer);
+	}
+
+	// Fill chunks for them with the next part of the file without holding the lock
+	const bool isSeeking = isSeekPending;
+	const uint32_t position = seekPosition;
+	const uint32_t fillSeekCount = seekCount;
+	const bool repeat = isRepeating;
+	const size_t chunkCount = freeBuffers.size();
+	isSeekPending = false;
+	lock.unlock();
+	if (isSeeking) {
+		readPosition = position;
+		file.clear();
+		file.seekg(dataOffset + std::streamoff(position));
+		if (isResampled) {
+			resampler.Reset();
+		}
+	}
+	size_t filledCount = 0;
+	while ((filledCount < chunkCount) && FillChunk(stagedChunks[filledCount], repeat)) {
+		filledCount++;
+	}
+	const bool isEndFilled = (readPosition >= dataSize) && !repeat;
+	lock.lock();
+
+	// Chunks read before a newer seek are dropped, the feeder reads again from the new position
+	if (seekCount != fillSeekCount) {
+		return;
+	}
+	for (size_t i = 0; i < filledCount; ++i) {
+		const std::vector<char> &chunk = stagedChunks[i];
+		alBufferData(freeBuffers.back(), format, chunk.empty() ? nullptr : &chunk[0], ALsizei(chunk.size()), bufferSampleRate);
+		if (alGetError() != AL_NO_ERROR) {
+			break;
+		}
+		alSourceQueueBuffers(source, 1, &freeBuffers.back());
+		freeBuffers.pop_back();
+	}
+	isEndQueued = isEndFilled;
+
+	// The source stops by itself when it runs out of queued data
+	if (isPlaying) {
+		ALint state, queuedCount;
+		alGetSourcei(source, AL_SOURCE_STATE, &state);
+		alGetSourcei(source, AL_BUFFERS_QUEUED, &queuedCount);
+		if (state != AL_PLAYING) {
+			if (queuedCount > 0) {
+				alSourcePlay(source);
+			} else {
+				isPlaying = false; // End of file reached
+			}
+		}
+	}
+}
+
+bool idSoundStream::FillChunk(std::vector<char> &chunk, const bool repeat) {
+	if ((readPosition >= dataSize) && repeat) {
+		readPosition = 0;
+		file.clear();
+		file.seekg(dataOffset);
+	}
+	if (readPosition >= dataSize) {
+		return false;
+	}
+
+	const uint32_t readSize = (dataSize - readPosition < readBuffer.size()) ?
+		(dataSize - readPosition) :
+		uint32_t(readBuffer.size());
+	if (file.read(&readBuffer[0], readSize).fail()) {
+		return false;
+	}
+	readPosition += readSize;
+
+	const char* samples = &readBuffer[0];
+	size_t samplesSize = readSize;
+	if (!convertBuffer.empty()) {
+		if (!ConvertWavData(fileFormat, &readBuffer[0], readSize, &convertBuffer[0], bufferSampleType, isDithered ? &ditherState : nullptr)) {
+			return false;
+		}
+		samples = &convertBuffer[0];
+		samplesSize = GetConvertedWavDataSize(fileFormat, bufferSampleType, readSize);
+
+		// Padding decoded at the end of the last compressed block isn't played (reads start on a block)
+		const size_t readStartFrame = size_t((readPosition - readSize) / uint32_t(fileFormat.blockAlign)) * size_t(fileFormat.framesPerBlock);
+		const size_t playedFrameCount = GetWavFrameCount(fileFormat, dataSize);
+		const size_t frameSize = size_t(fileFormat.numChannels) * GetSampleTypeSize(bufferSampleType);
+		const size_t playedSize = (playedFrameCount > readStartFrame) ? (playedFrameCount - readStartFrame) * frameSize : 0;
+		samplesSize = (std::min)(samplesSize, playedSize);
+	}
+
+	// The resampler carries its state from a buffer to the next one, and across loops
+	if (isResampled) {
+		const size_t channelCount = size_t(fileFormat.numChannels);
+		const size_t sampleCount = samplesSize / GetSampleTypeSize(bufferSampleType);
+		ConvertSamples(samples, bufferSampleType, sampleCount, reinterpret_cast<char*>(&resampleInput[0]), sampleType_t::FLOAT32, nullptr);
+		size_t frameCount = resampler.Process(&resampleInput[0], sampleCount / channelCount, &resampleOutput[0]);
+		if ((readPosition >= dataSize) && !repeat) {
+			frameCount += resampler.Flush(&resampleOutput[frameCount * channelCount]);
+		}
+		const sampleType_t resampledType = (bufferSampleType == sampleType_t::FLOAT32) ? sampleType_t::FLOAT32 : sampleType_t::INT16;
+		ConvertSamples(reinterpret_cast<const char*>(&resampleOutput[0]), sampleType_t::FLOAT32, frameCount * channelCount,
+			&resampleBuffer[0], resampledType, isDithered ? &ditherState : nullptr);
+		samples = &resampleBuffer[0];
+		samplesSize = frameCount * channelCount * GetSampleTypeSize(resampledType);
+	}
+
+	chunk.assign(samples, samples + samplesSize);
+	return true;
+}
+
+bool idSoundStream::Seek(const uint32_t position) {
+	// Rewinding keeps the buffers queued next unplayed, unlike stopping which marks them all as processed
+	alSourceRewind(source);
+	alSourcei(source, AL_BUFFER, 0);
+	freeBuffers.assign(buffers, buffers + STREAM_BUFFER_COUNT);
+
+	// The feeder moves reading to the position
+	seekPosition = position;
+	isSeekPending = true;
+	isEndQueued = false;
+	seekCount++;
+	feedCondition.notify_one();
+
+	return alGetError() == AL_NO_ERROR;
+}
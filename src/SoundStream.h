@@ -0,0 +1,96 @@
+#ifndef __SOUND_STREAM__
+#define __SOUND_STREAM__
+
+#include <OpenAL/al.h>
+
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "SoundUtils.h"
+#include "SoundResampler.h"
+
+// Plays a WAV file through a small ring of OpenAL buffers refilled from disk by a feeder thread,
+// so only a few hundred KB of the sound are resident at a time. Only the feeder reads the file
+class idSoundStream {
+	public:
+		static const unsigned int STREAM_BUFFER_SIZE = 64 * 1024; // About 0.37s of 44.1kHz stereo 16-bit sound
+
+		idSoundStream();
+		~idSoundStream();
+
+		// Samples wider than 16 bits are converted chunk by chunk, to floats if they're supported,
+		// each buffer of the ring holds up to bufferSize bytes of the file. Samples are also resampled
+		// to the output rate when one is given (unless the rates can't be converted). Without a feeder
+		// thread, buffers are only refilled by Pump
+		bool Open(const std::string &fileName, const bool isFloatSupported, const bool isDithered, const uint32_t bufferSize=STREAM_BUFFER_SIZE, const int32_t outputSampleRate=0, const bool hasFeedThread=true);
+		void Close();
+		// Refills played buffers on the caller's thread, when the stream was opened without a feeder thread
+		void Pump();
+		// Playback always starts from the beginning of the file, with the buffers filled after opening or stopping
+		bool Play(const bool repeat=false);
+		bool Pause();
+		bool Resume();
+		bool Stop();
+		bool SetPlaybackPosition(const float seconds);
+		bool SetGain(const float gain);
+	private:
+		static const unsigned int STREAM_BUFFER_COUNT = 4;
+		// Delay between two refills, must stay well below the duration of a buffer
+		static const unsigned int FEED_INTERVAL_MS = 10;
+
+		ALuint source;
+		ALuint buffers[STREAM_BUFFER_COUNT];
+		std::vector<ALuint> freeBuffers;
+		std::vector<char> stagedChunks[STREAM_BUFFER_COUNT]; // Filled by the feeder outside of the lock, then queued
+		std::vector<char> readBuffer;
+		std::vector<char> convertBuffer; // Empty when samples are used as they are read
+		// Resampling goes through floats, output samples are 16-bit unless the buffers hold floats
+		bool isResampled;
+		idSoundResampler resampler;
+		int32_t bufferSampleRate;
+		std::vector<float> resampleInput;
+		std::vector<float> resampleOutput;
+		std::vector<char> resampleBuffer;
+
+		std::ifstream file;
+		ALenum format;
+		sampleType_t sampleType;
+		sampleType_t bufferSampleType;
+		bool isDithered;
+		ditherState_t ditherState;
+		wavFormat_t fileFormat;
+		std::streamoff dataOffset;
+		uint32_t dataSize;
+		uint32_t readPosition; // Position of the next read in the sound data (feeder only)
+		bool isRepeating;
+		bool isPlaying; // Whether the source should be playing (to recover from underruns)
+		bool isAtStart; // Whether the queued buffers start the file and haven't been played yet
+		bool isEndQueued; // Whether the end of the file was queued without looping
+		bool isSeekPending;
+		uint32_t seekPosition;
+		uint32_t seekCount; // Chunks filled before the latest seek are dropped
+
+		std::thread feedThread;
+		std::atomic<bool> shouldStop;
+		std::mutex streamMutex; // Protects source, buffers and requests between the feeder and callers
+		std::condition_variable feedCondition; // Wakes the feeder early on seeks
+
+		void FeedLoop();
+		// Refills and queues free buffers, restarts the source if it ran dry. The lock is only released while the file is read
+		void Feed(std::unique_lock<std::mutex> &lock);
+		// Reads, converts and resamples the next part of the file into the chunk
+		bool FillChunk(std::vector<char> &chunk, const bool repeat);
+		// Drops queued buffers and has the feeder refill them from the position
+		bool Seek(const uint32_t position);
+
+		idSoundStream(const idSoundStream &other) = delete;
+		idSoundStream& operator=(const idSoundStream &other) = delete;
+};
+
+#endif
@@ -1,7 +1,17 @@
-#include <fstream>
+#include <cstring>
+#include <algorithm>
 
+#include <OpenAL/alext.h>
+
+#include "MappedFile.h"
 #include "SoundUtils.h"
 
+// SSE2 is always available on x86 and x64 Windows targets
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define SOUND_UTILS_SSE2
+#endif
+
 static int32_t CharArrayToInt(const char* const array, const size_t size) {
 	int32_t res = 0;
 	// Assumes we're on a little-endian machine (such as on Windows)
@@ -9,115 +19,555 @@ static int32_t CharArrayToInt(const char* const array, const size_t size) {
 	return res;
 }
 
-static bool LoadWavFileHeader(
-	std::ifstream &file, 
-	int32_t &numChannels,
-	int32_t &sampleRate,
-	int32_t &bitsPerSample,
-	int32_t &dataSize) {
-	char buffer[4];
+static const int32_t WAVE_FORMAT_PCM = 0x0001;
+static const int32_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+static const int32_t WAVE_FORMAT_IMA_ADPCM = 0x0011;
+static const int32_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+static const size_t CHUNK_HEADER_SIZE = 8;
+static const size_t CANONICAL_HEADER_SIZE = 44; // RIFF header, 16-byte "fmt " chunk and "data" chunk header
+static const size_t CONVERSION_CHUNK_SIZE = 1024; // Samples converted at once
+static const int32_t IMA_ADPCM_HEADER_SIZE = 4; // Per channel, at the start of each block
+static const int32_t IMA_ADPCM_GROUP_SIZE = 4; // Bytes of a channel's group of 8 samples
+static const int IMA_ADPCM_STEP_COUNT = 89;
 
-	// Read and check ChunkID
-	if (file.read(buffer, 4).fail() || std::strncmp(buffer, "RIFF", 4)) {
+static uint32_t CharArrayToUInt(const char* const array) {
+	return uint32_t(CharArrayToInt(array, 4));
+}
+
+// Extracts the format from the content of a "fmt " chunk
+static bool ParseWavFormatChunk(const char* const chunkData, const uint32_t chunkSize, wavFormat_t &format) {
+	if (chunkSize < 16) {
 		return false;
 	}
 
-	// Read ChunkSize
-	if (file.read(buffer, 4).fail()) {
-		return false;
+	// Extract AudioFormat / NumChannels / SampleRate / ByteRate / BlockAlign / BitsPerSample
+	format.audioFormat = CharArrayToInt(chunkData, 2);
+	format.numChannels = CharArrayToInt(chunkData + 2, 2);
+	format.sampleRate = CharArrayToInt(chunkData + 4, 4);
+	const int32_t byteRate = CharArrayToInt(chunkData + 8, 4);
+	format.blockAlign = CharArrayToInt(chunkData + 12, 2);
+	format.bitsPerSample = CharArrayToInt(chunkData + 14, 2);
+
+	// Extensible format stores the actual format in the first bytes of its sub-format GUID
+	if (format.audioFormat == WAVE_FORMAT_EXTENSIBLE) {
+		if ((chunkSize < 40) || (CharArrayToInt(chunkData + 16, 2) < 22)) {
+			return false;
+		}
+		format.audioFormat = CharArrayToInt(chunkData + 24, 2);
 	}
 
-	// Read and check Format
-	if (file.read(buffer, 4).fail() || std::strncmp(buffer, "WAVE", 4)) {
+	// Check values of ByteRate / BlockAlign / BitsPerSample (only meaningful for PCM data)
+	if ((format.numChannels <= 0) || (format.sampleRate <= 0) || (format.blockAlign <= 0)) {
 		return false;
 	}
+	format.framesPerBlock = 1;
+	format.factFrameCount = 0;
 
-	// Read and check Subchunk1ID
-	if (file.read(buffer, 4).fail() || std::strncmp(buffer, "fmt ", 4)) {
+	// IMA-ADPCM blocks start with a header per channel, followed by interleaved groups of 8 samples per channel
+	if (format.audioFormat == WAVE_FORMAT_IMA_ADPCM) {
+		if ((chunkSize < 20) || (format.bitsPerSample != 4)) {
+			return false;
+		}
+		format.framesPerBlock = CharArrayToInt(chunkData + 18, 2);
+		const int32_t groupsSize = format.blockAlign - IMA_ADPCM_HEADER_SIZE * format.numChannels;
+		if ((groupsSize <= 0) || (groupsSize % (IMA_ADPCM_GROUP_SIZE * format.numChannels) != 0) ||
+			(format.framesPerBlock != 1 + groupsSize * 2 / format.numChannels)) {
+			return false;
+		}
+	}
+	if (((format.audioFormat == WAVE_FORMAT_PCM) || (format.audioFormat == WAVE_FORMAT_IEEE_FLOAT)) &&
+		((byteRate != format.sampleRate * format.blockAlign) ||
+		(format.blockAlign != format.numChannels * format.bitsPerSample / 8))) {
 		return false;
 	}
 
-	// Read and check Subchunk1Size (20 in oct is 16 in dec)
-	if (file.read(buffer, 4).fail() || std::strncmp(buffer, "\20\0\0\0", 4)) {
+	return true;
+}
+
+// Parse WAVE file following the specification : http://soundfile.sapp.org/doc/WaveFormat/
+// Chunks other than "fmt ", "fact" and "data" (LIST, JUNK...) are skipped, "fact" only matters for compressed data
+bool ParseWavFile(
+	const char* const fileData,
+	const size_t fileSize,
+	wavFormat_t &format,
+	const char* &soundData,
+	uint32_t &soundDataSize) {
+	// Check ChunkID and Format
+	if ((fileSize < 12) || std::strncmp(fileData, "RIFF", 4) || std::strncmp(fileData + 8, "WAVE", 4)) {
 		return false;
 	}
 
-	// Read AudioFormat
-	if (file.read(buffer, 2).fail()) {
-		return false;
+	// Fast path for the canonical layout, where "data" directly follows a 16-byte "fmt " chunk
+	if ((fileSize >= CANONICAL_HEADER_SIZE) &&
+		!std::strncmp(fileData + 12, "fmt ", 4) && (CharArrayToUInt(fileData + 16) == 16) &&
+		!std::strncmp(fileData + 36, "data", 4)) {
+		soundDataSize = CharArrayToUInt(fileData + 40);
+		if ((soundDataSize > fileSize - CANONICAL_HEADER_SIZE) || !ParseWavFormatChunk(fileData + 20, 16, format)) {
+			return false;
+		}
+		soundData = fileData + CANONICAL_HEADER_SIZE;
+		return true;
 	}
 
-	// Read and extract NumChannels
-	if (file.read(buffer, 2).fail()) {
-		return false;
+	// Walk chunks up to the end of the RIFF chunk, some writers leave its size unset so it's capped by the file size
+	const size_t riffEnd = (CharArrayToUInt(fileData + 4) < fileSize - CHUNK_HEADER_SIZE) ?
+		CHUNK_HEADER_SIZE + CharArrayToUInt(fileData + 4) :
+		fileSize;
+	bool hasFormat = false;
+	bool hasData = false;
+	uint32_t factFrameCount = 0;
+	size_t offset = 12;
+	while (offset + CHUNK_HEADER_SIZE <= riffEnd) {
+		const char* const chunkId = fileData + offset;
+		const uint32_t chunkSize = CharArrayToUInt(fileData + offset + 4);
+		const size_t chunkDataOffset = offset + CHUNK_HEADER_SIZE;
+		if (chunkSize > riffEnd - chunkDataOffset) {
+			return false;
+		}
+
+		if (!std::strncmp(chunkId, "fmt ", 4)) {
+			if (!ParseWavFormatChunk(fileData + chunkDataOffset, chunkSize, format)) {
+				return false;
+			}
+			hasFormat = true;
+		} else if (!std::strncmp(chunkId, "data", 4)) {
+			soundData = fileData + chunkDataOffset;
+			soundDataSize = chunkSize;
+			hasData = true;
+		} else if (!std::strncmp(chunkId, "fact", 4) && (chunkSize >= 4)) {
+			factFrameCount = CharArrayToUInt(fileData + chunkDataOffset);
+		}
+		if (hasFormat && hasData) {
+			if (format.audioFormat == WAVE_FORMAT_IMA_ADPCM) {
+				format.factFrameCount = factFrameCount;
+			}
+			return true;
+		}
+
+		// Chunks are aligned on 2 bytes
+		offset = chunkDataOffset + chunkSize + (chunkSize & 1);
 	}
-	numChannels = CharArrayToInt(buffer, 2);
 
-	// Read and extract SampleRate
-	if (file.read(buffer, 4).fail()) {
+	return false;
+}
+
+bool OpenWavFile(
+	const std::string &fileName,
+	std::ifstream &file,
+	wavFormat_t &format,
+	uint32_t &soundDataSize) {
+	// Only header pages are read from the mapping, sound data is then read through the file
+	idMappedFile mappedFile;
+	const char* soundData;
+	if (!mappedFile.Open(fileName) ||
+		!ParseWavFile(mappedFile.GetData(), mappedFile.GetSize(), format, soundData, soundDataSize)) {
 		return false;
 	}
-	sampleRate = CharArrayToInt(buffer, 4);
 
-	// Read and extract ByteRate
-	if (file.read(buffer, 4).fail()) {
+	file.open(fileName, std::ios_base::binary);
+	if (file.fail() || !file.is_open()) {
 		return false;
 	}
-	int32_t byteRate = CharArrayToInt(buffer, 4);
+	file.seekg(std::streamoff(soundData - mappedFile.GetData()));
+
+	return !file.fail();
+}
 
-	// Read and extract BlockAlign
-	if (file.read(buffer, 2).fail()) {
+bool GetWavSampleType(const wavFormat_t &format, sampleType_t &sampleType) {
+	if (format.audioFormat == WAVE_FORMAT_IMA_ADPCM) {
+		sampleType = sampleType_t::IMA_ADPCM;
+		return true;
+	}
+	if (format.audioFormat == WAVE_FORMAT_IEEE_FLOAT) {
+		sampleType = sampleType_t::FLOAT32;
+		return format.bitsPerSample == 32;
+	}
+	if (format.audioFormat != WAVE_FORMAT_PCM) {
 		return false;
 	}
-	int32_t blockAlign = CharArrayToInt(buffer, 2);
 
-	// Read and extract BitsPerSample
-	if (file.read(buffer, 2).fail()) {
+	switch (format.bitsPerSample) {
+		case 8:
+			sampleType = sampleType_t::UINT8;
+			return true;
+		case 16:
+			sampleType = sampleType_t::INT16;
+			return true;
+		case 24:
+			sampleType = sampleType_t::INT24;
+			return true;
+		case 32:
+			sampleType = sampleType_t::INT32;
+			return true;
+		default:
+			return false;
+	}
+}
+
+size_t GetSampleTypeSize(const sampleType_t sampleType) {
+	switch (sampleType) {
+		case sampleType_t::UINT8:
+			return 1;
+		case sampleType_t::INT16:
+			return 2;
+		case sampleType_t::INT24:
+			return 3;
+		case sampleType_t::IMA_ADPCM:
+			return 0; // Only whole blocks have a size
+		default:
+			return 4;
+	}
+}
+
+bool GetWavBufferFormat(const wavFormat_t &format, const bool isFloatSupported, ALenum &bufferFormat, sampleType_t &bufferSampleType) {
+	sampleType_t sampleType;
+	if (!GetWavSampleType(format, sampleType) ||
+		((sampleType != sampleType_t::IMA_ADPCM) && (format.blockAlign != format.numChannels * int32_t(GetSampleTypeSize(sampleType))))) {
 		return false;
 	}
-	bitsPerSample = CharArrayToInt(buffer, 2);
 
-	// Check values of ByteRate / BlockAlign / BitsPerSample
-	if ((byteRate != sampleRate * numChannels * bitsPerSample / 8) ||
-		(blockAlign != numChannels * bitsPerSample / 8)) {
+	// 8 and 16-bit samples are used as they are, compressed ones don't gain anything from floats
+	if ((sampleType == sampleType_t::UINT8) || (sampleType == sampleType_t::INT16)) {
+		bufferSampleType = sampleType;
+	} else if (sampleType == sampleType_t::IMA_ADPCM) {
+		bufferSampleType = sampleType_t::INT16;
+	} else {
+		bufferSampleType = isFloatSupported ? sampleType_t::FLOAT32 : sampleType_t::INT16;
+	}
+
+	return GetBufferFormat(bufferSampleType, format.numChannels, bufferFormat);
+}
+
+bool GetBufferFormat(const sampleType_t bufferSampleType, const int32_t numChannels, ALenum &bufferFormat) {
+	if ((bufferSampleType != sampleType_t::UINT8) && (bufferSampleType != sampleType_t::INT16) && (bufferSampleType != sampleType_t::FLOAT32)) {
 		return false;
 	}
 
-	// Read and check Subchunk2ID
-	if (file.read(buffer, 4).fail() || std::strncmp(buffer, "data", 4)) {
+	if (numChannels == 1) {
+		if (bufferSampleType == sampleType_t::UINT8) {
+			bufferFormat = AL_FORMAT_MONO8;
+		} else if (bufferSampleType == sampleType_t::INT16) {
+			bufferFormat = AL_FORMAT_MONO16;
+		} else {
+			bufferFormat = AL_FORMAT_MONO_FLOAT32;
+		}
+	} else if (numChannels == 2) {
+		if (bufferSampleType == sampleType_t::UINT8) {
+			bufferFormat = AL_FORMAT_STEREO8;
+		} else if (bufferSampleType == sampleType_t::INT16) {
+			bufferFormat = AL_FORMAT_STEREO16;
+		} else {
+			bufferFormat = AL_FORMAT_STEREO_FLOAT32;
+		}
+	} else {
 		return false;
 	}
 
-	// Read and extract Subchunk2Size (number of bytes in data)
-	if (file.read(buffer, 4).fail()) {
+	return true;
+}
+
+// Next value of a xorshift generator
+static uint32_t NextDitherSeed(uint32_t seed) {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+void InitDitherState(ditherState_t &ditherState, const uint32_t seed) {
+	// Any non-zero seeds will do, they only need to differ between lanes
+	static const uint32_t LANE_SEEDS[4] = { 0x9E3779B9u, 0x7F4A7C15u, 0x85EBCA6Bu, 0xC2B2AE35u };
+	for (int i = 0; i < 4; ++i) {
+		ditherState.seeds[i] = NextDitherSeed(LANE_SEEDS[i] ^ (seed * 0x2545F491u));
+		if (ditherState.seeds[i] == 0) {
+			ditherState.seeds[i] = LANE_SEEDS[i];
+		}
+	}
+}
+
+// Converts count samples (up to CONVERSION_CHUNK_SIZE) to floats in [-1, 1)
+static void ConvertToFloats(const char* const source, const sampleType_t sourceType, const size_t count, float* const floats) {
+	size_t i = 0;
+	switch (sourceType) {
+		case sampleType_t::UINT8:
+			for (; i < count; ++i) {
+				floats[i] = float(int32_t(uint8_t(source[i])) - 128) * (1.0f / 128.0f);
+			}
+			break;
+		case sampleType_t::INT16: {
+#ifdef SOUND_UTILS_SSE2
+			// Sign-extend 8 samples to 32-bit integers by placing them in the high halves
+			const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+			for (; i + 8 <= count; i += 8) {
+				const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 2));
+				const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+				const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(packed, packed), 16);
+				_mm_storeu_ps(floats + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+				_mm_storeu_ps(floats + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+			}
+#endif
+			for (; i < count; ++i) {
+				floats[i] = float(int16_t(CharArrayToInt(source + i * 2, 2))) * (1.0f / 32768.0f);
+			}
+			break;
+		}
+		case sampleType_t::INT24: {
+#ifdef SOUND_UTILS_SSE2
+			// Each sample is read with the following byte, which is shifted out (the last ones are done one by one
+			// so the reads never go past the data)
+			const __m128 scale = _mm_set1_ps(1.0f / 8388608.0f);
+			for (; i + 5 <= count; i += 4) {
+				const char* const samples = source + i * 3;
+				const __m128i words = _mm_set_epi32(
+					CharArrayToInt(samples + 9, 4),
+					CharArrayToInt(samples + 6, 4),
+					CharArrayToInt(samples + 3, 4),
+					CharArrayToInt(samples, 4));
+				const __m128i values = _mm_srai_epi32(_mm_slli_epi32(words, 8), 8);
+				_mm_storeu_ps(floats + i, _mm_mul_ps(_mm_cvtepi32_ps(values), scale));
+			}
+#endif
+			for (; i < count; ++i) {
+				const int32_t value = int32_t(uint32_t(CharArrayToInt(source + i * 3, 3)) << 8) >> 8;
+				floats[i] = float(value) * (1.0f / 8388608.0f);
+			}
+			break;
+		}
+		case sampleType_t::INT32: {
+#ifdef SOUND_UTILS_SSE2
+			const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+			for (; i + 4 <= count; i += 4) {
+				const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+				_mm_storeu_ps(floats + i, _mm_mul_ps(_mm_cvtepi32_ps(values), scale));
+			}
+#endif
+			for (; i < count; ++i) {
+				floats[i] = float(CharArrayToInt(source + i * 4, 4)) * (1.0f / 2147483648.0f);
+			}
+			break;
+		}
+		case sampleType_t::FLOAT32:
+			std::memcpy(floats, source, count * sizeof(float));
+			break;
+		case sampleType_t::IMA_ADPCM:
+			break; // Decoded by blocks, see ConvertWavData
+	}
+}
+
+// Converts count floats (up to CONVERSION_CHUNK_SIZE) to saturated 16-bit samples
+static void ConvertFromFloats(const float* const floats, const size_t count, char* const destination, ditherState_t* const ditherState) {
+	size_t i = 0;
+#ifdef SOUND_UTILS_SSE2
+	const __m128 scale = _mm_set1_ps(32768.0f);
+	// Values are clamped first as out of range conversions don't saturate
+	const __m128 minValues = _mm_set1_ps(-32768.0f);
+	const __m128 maxValues = _mm_set1_ps(32767.0f);
+	const __m128i lowHalfMask = _mm_set1_epi32(0xFFFF);
+	const __m128 noiseScale = _mm_set1_ps(1.0f / 65536.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	__m128i seeds = _mm_setzero_si128();
+	if (ditherState != nullptr) {
+		seeds = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ditherState->seeds));
+	}
+	for (; i + 4 <= count; i += 4) {
+		__m128 values = _mm_mul_ps(_mm_loadu_ps(floats + i), scale);
+		if (ditherState != nullptr) {
+			// Both halves of the random bits are uniform values, their sum gives a triangular noise of one LSB on each side
+			seeds = _mm_xor_si128(seeds, _mm_slli_epi32(seeds, 13));
+			seeds = _mm_xor_si128(seeds, _mm_srli_epi32(seeds, 17));
+			seeds = _mm_xor_si128(seeds, _mm_slli_epi32(seeds, 5));
+			const __m128i halvesSum = _mm_add_epi32(_mm_srli_epi32(seeds, 16), _mm_and_si128(seeds, lowHalfMask));
+			values = _mm_add_ps(values, _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(halvesSum), noiseScale), one));
+		}
+		values = _mm_min_ps(_mm_max_ps(values, minValues), maxValues);
+		const __m128i integers = _mm_cvtps_epi32(values);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i * 2), _mm_packs_epi32(integers, integers));
+	}
+	if (ditherState != nullptr) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(ditherState->seeds), seeds);
+	}
+#endif
+	for (; i < count; ++i) {
+		float value = floats[i] * 32768.0f;
+		if (ditherState != nullptr) {
+			uint32_t &seed = ditherState->seeds[i & 3];
+			seed = NextDitherSeed(seed);
+			value += float((seed >> 16) + (seed & 0xFFFF)) * (1.0f / 65536.0f) - 1.0f;
+		}
+		value = (value < -32768.0f) ? -32768.0f : ((value > 32767.0f) ? 32767.0f : value);
+		const int16_t sample = int16_t((value < 0.0f) ? (value - 0.5f) : (value + 0.5f));
+		std::memcpy(destination + i * 2, &sample, 2);
+	}
+}
+
+bool ConvertSamples(
+	const char* const source,
+	const sampleType_t sourceType,
+	const size_t sampleCount,
+	char* const destination,
+	const sampleType_t destinationType,
+	ditherState_t* const ditherState) {
+	if (((destinationType != sampleType_t::INT16) && (destinationType != sampleType_t::FLOAT32)) ||
+		(sourceType == sampleType_t::IMA_ADPCM)) {
 		return false;
 	}
-	dataSize = CharArrayToInt(buffer, 4);
+
+	// Samples go through floats by chunks small enough to stay in cache
+	const size_t sourceSampleSize = GetSampleTypeSize(sourceType);
+	const size_t destinationSampleSize = GetSampleTypeSize(destinationType);
+	float floats[CONVERSION_CHUNK_SIZE];
+	for (size_t offset = 0; offset < sampleCount; offset += CONVERSION_CHUNK_SIZE) {
+		const size_t count = (sampleCount - offset < CONVERSION_CHUNK_SIZE) ? (sampleCount - offset) : CONVERSION_CHUNK_SIZE;
+		char* const chunkDestination = destination + offset * destinationSampleSize;
+		if (destinationType == sampleType_t::FLOAT32) {
+			ConvertToFloats(source + offset * sourceSampleSize, sourceType, count, reinterpret_cast<float*>(chunkDestination));
+		} else {
+			ConvertToFloats(source + offset * sourceSampleSize, sourceType, count, floats);
+			ConvertFromFloats(floats, count, chunkDestination, ditherState);
+		}
+	}
 
 	return true;
 }
 
-// Load WAVE file following the specification : http://soundfile.sapp.org/doc/WaveFormat/
-// (only works for files following the canonical WAVE format with 2 subchunks)
-char* LoadWavFile(
-	const std::string &fileName, 
-	int32_t &numChannels,
-	int32_t &sampleRate,
-	int32_t &bitsPerSample,
-	int32_t &dataSize) {
-	std::ifstream file(fileName, std::ios_base::binary);
-	if (file.fail() || !file.is_open())
-		return nullptr;
+// Decoding tables indexed by step index and 4-bit code, so decoding a sample takes no branch
+struct imaAdpcmTables_t {
+	int32_t differences[IMA_ADPCM_STEP_COUNT][16];
+	uint8_t nextStepIndices[IMA_ADPCM_STEP_COUNT][16];
+
+	imaAdpcmTables_t() {
+		static const int32_t STEPS[IMA_ADPCM_STEP_COUNT] = {
+			7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+			50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+			337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+			2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+			15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+		};
+		static const int INDEX_CHANGES[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+		for (int stepIndex = 0; stepIndex < IMA_ADPCM_STEP_COUNT; ++stepIndex) {
+			const int32_t step = STEPS[stepIndex];
+			for (int code = 0; code < 16; ++code) {
+				int32_t difference = step >> 3;
+				if (code & 1) {
+					difference += step >> 2;
+				}
+				if (code & 2) {
+					difference += step >> 1;
+				}
+				if (code & 4) {
+					difference += step;
+				}
+				differences[stepIndex][code] = (code & 8) ? -difference : difference;
+
+				const int nextStepIndex = stepIndex + INDEX_CHANGES[code & 7];
+				nextStepIndices[stepIndex][code] = uint8_t((nextStepIndex < 0) ? 0 : ((nextStepIndex >= IMA_ADPCM_STEP_COUNT) ? IMA_ADPCM_STEP_COUNT - 1 : nextStepIndex));
+			}
+		}
+	}
+};
+
+static const imaAdpcmTables_t& GetImaAdpcmTables() {
+	static const imaAdpcmTables_t tables;
+	return tables;
+}
+
+// Frames held by the data, a block cut short at the end is decoded up to its last whole group
+static size_t GetImaAdpcmFrameCount(const wavFormat_t &format, const size_t dataSize) {
+	const size_t headersSize = size_t(IMA_ADPCM_HEADER_SIZE * format.numChannels);
+	const size_t groupsSize = size_t(IMA_ADPCM_GROUP_SIZE * format.numChannels);
+	const size_t lastBlockSize = dataSize % size_t(format.blockAlign);
+
+	size_t frameCount = (dataSize / size_t(format.blockAlign)) * size_t(format.framesPerBlock);
+	if (lastBlockSize >= headersSize) {
+		frameCount += 1 + ((lastBlockSize - headersSize) / groupsSize) * 8;
+	}
+	return frameCount;
+}
+
+// Decodes the first frameCount frames of a block to interleaved 16-bit samples
+static void DecodeImaAdpcmBlock(const char* const block, const int32_t numChannels, const size_t frameCount, int16_t* const output) {
+	const imaAdpcmTables_t &tables = GetImaAdpcmTables();
+	const size_t channelCount = size_t(numChannels);
+	const size_t groupCount = (frameCount - 1) / 8;
+	const char* const groups = block + IMA_ADPCM_HEADER_SIZE * numChannels;
 
-	if (!LoadWavFileHeader(file, numChannels, sampleRate, bitsPerSample, dataSize)) {
-		return nullptr;
+	for (size_t channel = 0; channel < channelCount; ++channel) {
+		// First sample is stored as is in the header
+		const char* const header = block + channel * IMA_ADPCM_HEADER_SIZE;
+		int32_t predictor = int16_t(CharArrayToInt(header, 2));
+		int32_t stepIndex = uint8_t(header[2]);
+		if (stepIndex >= IMA_ADPCM_STEP_COUNT) {
+			stepIndex = IMA_ADPCM_STEP_COUNT - 1;
+		}
+		output[channel] = int16_t(predictor);
+
+		// Groups of each channel are interleaved, low nibbles come first
+		int16_t* sample = output + channelCount + channel;
+		for (size_t group = 0; group < groupCount; ++group) {
+			const char* const codes = groups + (group * channelCount + channel) * IMA_ADPCM_GROUP_SIZE;
+			for (int i = 0; i < IMA_ADPCM_GROUP_SIZE * 2; ++i) {
+				const int code = (uint8_t(codes[i >> 1]) >> ((i & 1) * 4)) & 0xF;
+				predictor += tables.differences[stepIndex][code];
+				predictor = (predictor < -32768) ? -32768 : ((predictor > 32767) ? 32767 : predictor);
+				stepIndex = tables.nextStepIndices[stepIndex][code];
+				*sample = int16_t(predictor);
+				sample += channelCount;
+			}
+		}
 	}
+}
 
-	char* data = new char[dataSize];
-	if (file.read(data, dataSize).fail()) {
-		delete[] data;
-		return nullptr;
+size_t GetConvertedWavDataSize(const wavFormat_t &format, const sampleType_t bufferSampleType, const size_t dataSize) {
+	const size_t frameCount = (format.audioFormat == WAVE_FORMAT_IMA_ADPCM) ?
+		GetImaAdpcmFrameCount(format, dataSize) :
+		dataSize / size_t(format.blockAlign);
+	return frameCount * size_t(format.numChannels) * GetSampleTypeSize(bufferSampleType);
+}
+
+size_t GetWavFrameCount(const wavFormat_t &format, const size_t dataSize) {
+	if (format.audioFormat != WAVE_FORMAT_IMA_ADPCM) {
+		return dataSize / size_t(format.blockAlign);
 	}
 
-	return data;
+	const size_t frameCount = GetImaAdpcmFrameCount(format, dataSize);
+	return (format.factFrameCount > 0) ? (std::min)(frameCount, size_t(format.factFrameCount)) : frameCount;
+}
+
+bool ConvertWavData(
+	const wavFormat_t &format,
+	const char* const data,
+	const size_t dataSize,
+	char* const destination,
+	const sampleType_t bufferSampleType,
+	ditherState_t* const ditherState) {
+	sampleType_t sampleType;
+	if (!GetWavSampleType(format, sampleType)) {
+		return false;
+	}
+
+	if (sampleType != sampleType_t::IMA_ADPCM) {
+		const size_t sampleCount = (dataSize / size_t(format.blockAlign)) * size_t(format.numChannels);
+		if (sampleType == bufferSampleType) {
+			std::memcpy(destination, data, sampleCount * GetSampleTypeSize(sampleType));
+			return true;
+		}
+		return ConvertSamples(data, sampleType, sampleCount, destination, bufferSampleType, ditherState);
+	}
+
+	if (bufferSampleType != sampleType_t::INT16) {
+		return false;
+	}
+	const size_t blockSize = size_t(format.blockAlign);
+	int16_t* output = reinterpret_cast<int16_t*>(destination);
+	for (size_t offset = 0; offset < dataSize; offset += blockSize) {
+		const size_t frameCount = GetImaAdpcmFrameCount(format, (dataSize - offset < blockSize) ? (dataSize - offset) : blockSize);
+		if (frameCount == 0) {
+			break;
+		}
+		DecodeImaAdpcmBlock(data + offset, format.numChannels, frameCount, output);
+		output += frameCount * size_t(format.numChannels);
+	}
+
+	return true;
 }
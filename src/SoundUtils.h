@@ -1,13 +1,91 @@
 #ifndef __SOUND_UTILS__
 #define __SOUND_UTILS__
 
+#include <cstdint>
+#include <cstddef>
 #include <string>
+#include <fstream>
 
-char* LoadWavFile(
+#include <OpenAL/al.h>
+
+// Type of the samples of sound data
+enum class sampleType_t {
+	UINT8,
+	INT16,
+	INT24, // Packed on 3 bytes
+	INT32,
+	FLOAT32,
+	IMA_ADPCM // 4-bit samples in independent blocks of wavFormat_t::blockAlign bytes
+};
+
+// State of the dither noise generator, carried from a converted chunk of a sound to the next one
+struct ditherState_t {
+	uint32_t seeds[4];
+};
+
+struct wavFormat_t {
+	int32_t audioFormat; // Format tag (the sub-format one for WAVE_FORMAT_EXTENSIBLE files)
+	int32_t numChannels;
+	int32_t sampleRate;
+	int32_t bitsPerSample;
+	int32_t blockAlign;
+	int32_t framesPerBlock; // 1 for PCM, frames decoded from each block for compressed data
+	uint32_t factFrameCount; // Frames of compressed data given by the fact chunk, 0 when not given
+};
+
+// Locates the sound data of a WAV file held in memory (soundData points inside fileData, nothing is copied)
+bool ParseWavFile(
+	const char* const fileData,
+	const size_t fileSize,
+	wavFormat_t &format,
+	const char* &soundData,
+	uint32_t &soundDataSize);
+
+// Opens the file and leaves it positioned at the start of the sound data
+bool OpenWavFile(
 	const std::string &fileName,
-	int32_t &numChannels,
-	int32_t &sampleRate,
-	int32_t &bitsPerSample,
-	int32_t &dataSize);
+	std::ifstream &file,
+	wavFormat_t &format,
+	uint32_t &soundDataSize);
+
+// Returns false if the sound data isn't 8/16/24/32-bit integer PCM, 32-bit float PCM or IMA-ADPCM
+bool GetWavSampleType(const wavFormat_t &format, sampleType_t &sampleType);
+size_t GetSampleTypeSize(const sampleType_t sampleType);
+
+// Computes the OpenAL buffer format able to hold the sound data (returns false if it isn't supported),
+// samples wider than 16 bits must first be converted to bufferSampleType (floats if AL_EXT_float32 is supported)
+// and compressed samples decoded to 16 bits
+bool GetWavBufferFormat(const wavFormat_t &format, const bool isFloatSupported, ALenum &bufferFormat, sampleType_t &bufferSampleType);
+// OpenAL buffer format of mono or stereo 8-bit, 16-bit or float samples
+bool GetBufferFormat(const sampleType_t bufferSampleType, const int32_t numChannels, ALenum &bufferFormat);
+
+// Parts of a sound converted separately should use different seeds, so their noise isn't correlated
+void InitDitherState(ditherState_t &ditherState, const uint32_t seed=0);
+
+// Size of the sound data once converted to the buffer sample type (dataSize should hold whole blocks)
+size_t GetConvertedWavDataSize(const wavFormat_t &format, const sampleType_t bufferSampleType, const size_t dataSize);
+// Frames of the whole sound data that are played, the last compressed block being padded up to
+// framesPerBlock frames unless the fact chunk gives the actual count
+size_t GetWavFrameCount(const wavFormat_t &format, const size_t dataSize);
+
+// Converts or decodes the sound data to the buffer sample type (see GetConvertedWavDataSize for the destination size),
+// blocks are independent so parts of the data starting on a block can be converted separately
+bool ConvertWavData(
+	const wavFormat_t &format,
+	const char* const data,
+	const size_t dataSize,
+	char* const destination,
+	const sampleType_t bufferSampleType,
+	ditherState_t* const ditherState);
+
+// Converts samples to 16-bit integers or floats, adding triangular dither noise when reducing them to
+// 16 bits if a dither state is given (destination must hold sampleCount samples of the destination type)
+bool ConvertSamples(
+	const char* const source,
+	const sampleType_t sourceType,
+	const size_t sampleCount,
+	char* const destination,
+	const sampleType_t destinationType,
+	ditherState_t* const ditherState);
 
 #endif
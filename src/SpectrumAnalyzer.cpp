@@ -0,0 +1,179 @@
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+#include "SpectrumAnalyzer.h"
+#include "SoundUtils.h"
+#include "MappedFile.h"
+
+const unsigned int idSpectrumAnalyzer::BAND_COUNT;
+const uint8_t idSpectrumAnalyzer::MAX_LEVEL;
+const size_t idSpectrumAnalyzer::FFT_SIZE;
+const unsigned int idSpectrumAnalyzer::UPDATE_INTERVAL_MS;
+const float idSpectrumAnalyzer::MIN_FREQUENCY = 40.0f;
+const float idSpectrumAnalyzer::MAX_FREQUENCY = 16000.0f;
+const float idSpectrumAnalyzer::DYNAMIC_RANGE_DB = 60.0f;
+const float idSpectrumAnalyzer::DECAY_PER_SECOND = 1.5f;
+
+idSpectrumAnalyzer::idSpectrumAnalyzer()
+: fileName()
+, shouldStop(false)
+, playbackSeconds(0.0f)
+, publishCount(0)
+, readCount(0) {
+	for (unsigned int band = 0; band < BAND_COUNT; ++band) {
+		bandLevels[0][band] = 0;
+		bandLevels[1][band] = 0;
+	}
+}
+
+idSpectrumAnalyzer::~idSpectrumAnalyzer() {
+	Stop();
+}
+
+void idSpectrumAnalyzer::Start(const std::string &_fileName) {
+	Stop();
+	fileName = _fileName;
+	playbackSeconds = 0.0f;
+
+	shouldStop = false;
+	analyzerThread = std::thread(&idSpectrumAnalyzer::AnalyzeLoop, this);
+}
+
+void idSpectrumAnalyzer::Stop() {
+	if (analyzerThread.joinable()) {
+		shouldStop = true;
+		analyzerThread.join();
+	}
+}
+
+void idSpectrumAnalyzer::SetPlaybackPosition(const float seconds) {
+	playbackSeconds.store(seconds, std::memory_order_relaxed);
+}
+
+bool idSpectrumAnalyzer::GetBandLevels(uint8_t* const levels) {
+	const uint32_t count = publishCount.load(std::memory_order_acquire);
+	if (count == readCount) {
+		return false;
+	}
+
+	uint8_t copiedLevels[BAND_COUNT];
+	const std::atomic<uint8_t>* const bands = bandLevels[count & 1];
+	for (unsigned int band = 0; band < BAND_COUNT; ++band) {
+		copiedLevels[band] = bands[band].load(std::memory_order_relaxed);
+	}
+	// A newer publication may have started rewriting these bands during the copy, they're read again next time
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (publishCount.load(std::memory_order_relaxed) != count) {
+		return false;
+	}
+
+	std::copy(copiedLevels, copiedLevels + BAND_COUNT, levels);
+	readCount = count;
+	return true;
+}
+
+void idSpectrumAnalyzer::AnalyzeLoop() {
+	// Samples are read straight from the mapped file, only the pages around the playback position are loaded
+	idMappedFile file;
+	wavFormat_t format;
+	const char* soundData;
+	uint32_t soundDataSize;
+	sampleType_t sampleType;
+	idFft fft;
+	if (!file.Open(fileName) ||
+		!ParseWavFile(file.GetData(), file.GetSize(), format, soundData, soundDataSize) ||
+		!GetWavSampleType(format, sampleType) ||
+		!fft.Init(FFT_SIZE)) {
+		return;
+	}
+
+	// Bands are spaced evenly on a logarithmic scale, each one holding at least one bin
+	const size_t binCount = fft.GetBinCount();
+	const float binFrequency = float(format.sampleRate) / float(FFT_SIZE);
+	const float maxFrequency = (std::min)(MAX_FREQUENCY, 0.5f * float(format.sampleRate));
+	size_t bandStartBins[BAND_COUNT + 1];
+	for (unsigned int band = 0; band <= BAND_COUNT; ++band) {
+		const float frequency = MIN_FREQUENCY * std::pow(maxFrequency / MIN_FREQUENCY, float(band) / float(BAND_COUNT));
+		bandStartBins[band] = size_t(frequency / binFrequency + 0.5f);
+		if ((band > 0) && (bandStartBins[band] <= bandStartBins[band - 1])) {
+			bandStartBins[band] = bandStartBins[band - 1] + 1;
+		}
+		bandStartBins[band] = (std::min)(bandStartBins[band], binCount);
+	}
+	// Magnitude of a full scale sine once the Hann window halved it
+	const float fullScaleMagnitude = float(FFT_SIZE) / 4.0f;
+
+	// Whole blocks are decoded, a window spans at most two more than its frames
+	const size_t channelCount = size_t(format.numChannels);
+	const size_t blockSize = size_t(format.blockAlign);
+	const size_t framesPerBlock = size_t(format.framesPerBlock);
+	const size_t frameCount = (std::min)((soundDataSize / blockSize) * framesPerBlock, GetWavFrameCount(format, soundDataSize));
+	std::vector<int16_t> decodedSamples((FFT_SIZE / framesPerBlock + 2) * framesPerBlock * channelCount);
+	std::vector<float> samples(FFT_SIZE);
+	std::vector<float> magnitudes(binCount);
+
+	float levels[BAND_COUNT] = {};
+	float analyzedSeconds = -1.0f;
+	std::chrono::steady_clock::time_point previousAnalysisTime = std::chrono::steady_clock::now();
+	while (!shouldStop) {
+		const float seconds = playbackSeconds.load(std::memory_order_relaxed);
+		if (seconds != analyzedSeconds) {
+			analyzedSeconds = seconds;
+
+			// Window ends on the frame being heard, frames outside of the song are silent
+			const int64_t endFrame = int64_t(double(seconds) * double(format.sampleRate));
+			const int64_t startFrame = endFrame - int64_t(FFT_SIZE);
+			const size_t readStart = size_t((std::max)(int64_t(0), (std::min)(startFrame, int64_t(frameCount))));
+			const size_t readEnd = size_t((std::max)(int64_t(0), (std::min)(endFrame, int64_t(frameCount))));
+			std::fill(samples.begin(), samples.end(), 0.0f);
+			if (readStart < readEnd) {
+				const size_t firstBlock = readStart / framesPerBlock;
+				const size_t endBlock = (readEnd + framesPerBlock - 1) / framesPerBlock;
+				if (ConvertWavData(format, soundData + firstBlock * blockSize, (endBlock - firstBlock) * blockSize,
+					reinterpret_cast<char*>(&decodedSamples[0]), sampleType_t::INT16, nullptr)) {
+					// Channels are mixed down to mono
+					const float scale = 1.0f / (32768.0f * float(channelCount));
+					for (size_t frame = readStart; frame < readEnd; ++frame) {
+						const int16_t* const frameSamples = &decodedSamples[(frame - firstBlock * framesPerBlock) * channelCount];
+						int32_t sum = 0;
+						for (size_t channel = 0; channel < channelCount; ++channel) {
+							sum += frameSamples[channel];
+						}
+						samples[size_t(int64_t(frame) - startFrame)] = float(sum) * scale;
+					}
+				}
+			}
+
+			fft.ComputeMagnitudes(&samples[0], &magnitudes[0]);
+
+			const std::chrono::steady_clock::time_point analysisTime = std::chrono::steady_clock::now();
+			const float decay = DECAY_PER_SECOND * std::chrono::duration<float>(analysisTime - previousAnalysisTime).count();
+			previousAnalysisTime = analysisTime;
+			for (unsigned int band = 0; band < BAND_COUNT; ++band) {
+				float peakMagnitude = 0.0f;
+				for (size_t bin = bandStartBins[band]; bin < bandStartBins[band + 1]; ++bin) {
+					peakMagnitude = (std::max)(peakMagnitude, magnitudes[bin]);
+				}
+				const float decibels = 20.0f * std::log10((std::max)(peakMagnitude / fullScaleMagnitude, 1e-6f));
+				const float level = (std::max)(0.0f, (std::min)(1.0f, 1.0f + decibels / DYNAMIC_RANGE_DB));
+				levels[band] = (std::max)(level, levels[band] - decay);
+			}
+			PublishBandLevels(levels);
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(UPDATE_INTERVAL_MS));
+	}
+}
+
+void idSpectrumAnalyzer::PublishBandLevels(const float* const levels) {
+	const uint32_t count = publishCount.load(std::memory_order_relaxed);
+	// Readers may still copy the published bands, but not these ones unless they're late by a publication,
+	// in which case the fence lets them see the count changed
+	std::atomic_thread_fence(std::memory_order_release);
+	std::atomic<uint8_t>* const bands = bandLevels[(count + 1) & 1];
+	for (unsigned int band = 0; band < BAND_COUNT; ++band) {
+		bands[band].store(uint8_t(levels[band] * float(MAX_LEVEL) + 0.5f), std::memory_order_relaxed);
+	}
+	publishCount.store(count + 1, std::memory_order_release);
+}
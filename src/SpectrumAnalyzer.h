@@ -0,0 +1,59 @@
+#ifndef __SPECTRUM_ANALYZER__
+#define __SPECTRUM_ANALYZER__
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include "Fft.h"
+
+// Computes the spectrum of a song around its playback position on a worker thread, as a few frequency
+// bands with levels from 0 to MAX_LEVEL. Callers only set the position and copy the latest published bands.
+class idSpectrumAnalyzer {
+	public:
+		static const unsigned int BAND_COUNT = 24;
+		static const uint8_t MAX_LEVEL = 255;
+
+		idSpectrumAnalyzer();
+		~idSpectrumAnalyzer();
+
+		// The WAV file is opened by the worker, bands stay silent if it can't be read
+		void Start(const std::string &_fileName);
+		void Stop();
+		// Position of the audio being heard, bands are only computed again when it changes
+		void SetPlaybackPosition(const float seconds);
+		// Copies BAND_COUNT levels, returns false if no bands were published since the latest copy
+		bool GetBandLevels(uint8_t* const levels);
+	private:
+		// About 46ms of 44.1kHz sound, the lowest band is still a few bins wide
+		static const size_t FFT_SIZE = 2048;
+		static const unsigned int UPDATE_INTERVAL_MS = 15;
+		static const float MIN_FREQUENCY;
+		static const float MAX_FREQUENCY;
+		// Levels range from this many decibels below a full scale sine to a full scale sine
+		static const float DYNAMIC_RANGE_DB;
+		// Levels rise at once, but fall slowly so bars stay readable
+		static const float DECAY_PER_SECOND;
+
+		std::string fileName;
+		std::thread analyzerThread;
+		std::atomic<bool> shouldStop;
+		std::atomic<float> playbackSeconds;
+
+		// Double buffer of bands: the worker writes the one after the published one, then publishes it by
+		// incrementing the count. Copies overlapping a write are detected through the count and dropped.
+		std::atomic<uint8_t> bandLevels[2][BAND_COUNT];
+		std::atomic<uint32_t> publishCount;
+		uint32_t readCount; // Count of the latest copied bands, only used by the reading thread
+
+		void AnalyzeLoop();
+		void PublishBandLevels(const float* const levels);
+
+		idSpectrumAnalyzer(const idSpectrumAnalyzer &other) = delete;
+		idSpectrumAnalyzer& operator=(const idSpectrumAnalyzer &other) = delete;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef __SPSC_QUEUE__
+#define __SPSC_QUEUE__
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free queue for exactly one producer thread and one consumer thread
+// (CAPACITY must be a power of two, one slot is kept empty to tell full from empty)
+template<typename T, size_t CAPACITY>
+class idSpscQueue {
+	public:
+		idSpscQueue() : readIndex(0), writeIndex(0) {}
+
+		// Called by the producer thread only (returns false if the queue is full)
+		bool Push(const T &element) {
+			const size_t write = writeIndex.load(std::memory_order_relaxed);
+			const size_t nextWrite = (write + 1) & INDEX_MASK;
+			if (nextWrite == readIndex.load(std::memory_order_acquire)) {
+				return false;
+			}
+			elements[write] = element;
+			writeIndex.store(nextWrite, std::memory_order_release);
+			return true;
+		}
+
+		// Called by the consumer thread only (returns false if the queue is empty)
+		bool Pop(T &element) {
+			const size_t read = readIndex.load(std::memory_order_relaxed);
+			if (read == writeIndex.load(std::memory_order_acquire)) {
+				return false;
+			}
+			element = elements[read];
+			readIndex.store((read + 1) & INDEX_MASK, std::memory_order_release);
+			return true;
+		}
+
+		// Called by the consumer thread only, drops all queued elements
+		void Clear() {
+			readIndex.store(writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+		}
+	private:
+		static_assert((CAPACITY & (CAPACITY - 1)) == 0, "idSpscQueue capacity must be a power of two");
+		static const size_t INDEX_MASK = CAPACITY - 1;
+
+		T elements[CAPACITY];
+		// Indices are kept on separate cache lines so both threads don't fight over them
+		alignas(64) std::atomic<size_t> readIndex;
+		alignas(64) std::atomic<size_t> writeIndex;
+};
+
+#endif
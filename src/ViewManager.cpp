@@ -1,4 +1,5 @@
 #include <cmath>
+#include <algorithm>
 #include <windows.h>
 #include <sstream>
 #include <iomanip>
@@ -156,6 +157,100 @@ void idViewManager::UpdateUI(const int timeSinceStart, const int score, const in
 	}
 }
 
+void idViewManager::DrawPauseMenu() {
+	const int PAUSE_ORIGIN_Y = CONSOLE_HEIGHT / 3;
+
+	canvas.DrawCenteredString(LevelPlay::PAUSE_TITLE, 0, PAUSE_ORIGIN_Y, NOTES_AREA_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+	canvas.DrawMultilineString(LevelPlay::PAUSE_INSTRUCTIONS, 0, PAUSE_ORIGIN_Y + 4, BACKGROUND_COLOR, TEXT_COLOR, true, NOTES_AREA_WIDTH);
+}
+
+void idViewManager::DrawResumeCountdown(const int secondsLeft) {
+	canvas.DrawCenteredString(std::to_string(secondsLeft), 0, CONSOLE_HEIGHT / 3, NOTES_AREA_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+}
+
+void idViewManager::DrawPerformanceOverlay(const float frameMilliseconds, const float outputLatencyMilliseconds, const bool isLatencyMeasured,
+	const float mixerLatencyMilliseconds, const unsigned int activeVoiceCount, const unsigned int voiceCount,
+	const float cachedMegabytes, const float bufferMegabytes, const float budgetMegabytes,
+	const unsigned int cacheHitCount, const unsigned int bufferLoadCount, const unsigned int evictionCount) {
+	// Keysounds are heard after the mixer latency on top of the output one
+	std::stringstream overlayStream;
+	overlayStream << std::fixed << std::setprecision(1)
+		<< PerformanceOverlay::FRAME_TIME_TITLE << frameMilliseconds << "ms  "
+		<< PerformanceOverlay::OUTPUT_LATENCY_TITLE << outputLatencyMilliseconds << "ms" << (isLatencyMeasured ? "" : PerformanceOverlay::ESTIMATED_SUFFIX)
+		<< "+" << mixerLatencyMilliseconds << "  "
+		<< PerformanceOverlay::VOICES_TITLE << activeVoiceCount << "/" << voiceCount;
+
+	// Cached sounds are part of the loaded ones, which the cache keeps within the budget
+	std::stringstream cacheStream;
+	cacheStream << std::fixed << std::setprecision(1)
+		<< PerformanceOverlay::CACHE_TITLE << cachedMegabytes << "MB  "
+		<< PerformanceOverlay::BUFFERS_TITLE << bufferMegabytes << "/" << budgetMegabytes << "MB  "
+		<< PerformanceOverlay::CACHE_HITS_TITLE << cacheHitCount << "/" << bufferLoadCount << "  "
+		<< PerformanceOverlay::EVICTIONS_TITLE << evictionCount;
+
+	ClearPerformanceOverlay();
+	canvas.DrawCenteredString(cacheStream.str(), CONSOLE_WIDTH - UI_WIDTH + 1, CONSOLE_HEIGHT - 6, UI_WIDTH - 2, BACKGROUND_COLOR, TEXT_COLOR);
+	canvas.DrawCenteredString(overlayStream.str(), CONSOLE_WIDTH - UI_WIDTH + 1, CONSOLE_HEIGHT - 2, UI_WIDTH - 2, BACKGROUND_COLOR, TEXT_COLOR);
+}
+
+void idViewManager::ClearPerformanceOverlay() {
+	canvas.DrawCharHLine(CONSOLE_WIDTH - UI_WIDTH + 1, UI_WIDTH - 2, CONSOLE_HEIGHT - 6, ' ', BACKGROUND_COLOR, BACKGROUND_COLOR);
+	canvas.DrawCharHLine(CONSOLE_WIDTH - UI_WIDTH + 1, UI_WIDTH - 2, CONSOLE_HEIGHT - 2, ' ', BACKGROUND_COLOR, BACKGROUND_COLOR);
+}
+
+void idViewManager::DrawSpectrum(const uint8_t* const bandLevels, const size_t bandCount, const uint8_t maxLevel) {
+	// Bars fill the rows above the performance overlay, in eighths of a character
+	const int SPECTRUM_HEIGHT = 3;
+	const int SPECTRUM_BOTTOM_Y = CONSOLE_HEIGHT - 3;
+	const int SPECTRUM_WIDTH = UI_WIDTH - 2;
+	const int bandWidth = SPECTRUM_WIDTH / int(bandCount);
+	const int spectrumOriginX = CONSOLE_WIDTH - UI_WIDTH + 1 + (SPECTRUM_WIDTH - bandWidth * int(bandCount)) / 2;
+
+	for (size_t band = 0; band < bandCount; ++band) {
+		const int eighths = (int(bandLevels[band]) * SPECTRUM_HEIGHT * 8 + maxLevel / 2) / maxLevel;
+		for (int row = 0; row < SPECTRUM_HEIGHT; ++row) {
+			const int filledEighths = (std::min)((std::max)(eighths - row * 8, 0), 8);
+			const WCHAR barChar = (filledEighths == 0) ? L' ' : WCHAR(0x2580 + filledEighths);
+			canvas.DrawCharHLine(spectrumOriginX + int(band) * bandWidth, bandWidth, SPECTRUM_BOTTOM_Y - row, barChar, BACKGROUND_COLOR, TEXT_COLOR);
+		}
+	}
+}
+
+void idViewManager::DrawRecordUI(const std::string &songName, const int songLength) {
+	const int UI_X_ORIGIN = CONSOLE_WIDTH - UI_WIDTH;
+	const std::string TIME_STRING = "00:00 / " + GetFormattedTime(songLength);
+
+	// Draw top info titles
+	canvas.DrawCenteredString(songName, UI_X_ORIGIN, 2, UI_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+	canvas.DrawCenteredString(TIME_STRING, UI_X_ORIGIN, 4, UI_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+
+	// Draw bottom info titles
+	canvas.DrawCenteredString(LevelRecord::RECORDING_TITLE, UI_X_ORIGIN, 10, UI_WIDTH, BACKGROUND_COLOR, BAD_COLOR);
+	canvas.DrawCenteredString(LevelRecord::RECORDED_NOTES_COUNT_TITLE, UI_X_ORIGIN, 16, UI_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+	canvas.DrawCenteredString(LevelRecord::QUANTIZE_TITLE, UI_X_ORIGIN, 22, UI_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+}
+
+void idViewManager::UpdateRecordUI(const int timeSinceStart, const int recordedNotesCount, const bool isQuantized) {
+	const int INFO_ORIGIN = CONSOLE_WIDTH - UI_WIDTH + 1;
+	const int INFO_WIDTH = UI_WIDTH - 2;
+	const int TIME_STRING_LENGTH = 13;
+
+	// Draw top info
+	canvas.DrawString(GetFormattedTime(timeSinceStart), INFO_ORIGIN + (INFO_WIDTH - TIME_STRING_LENGTH) / 2, 4, BACKGROUND_COLOR, TEXT_COLOR);
+
+	// Clear previous info
+	canvas.DrawCharHLine(INFO_ORIGIN, INFO_WIDTH, 18, ' ', BACKGROUND_COLOR, BACKGROUND_COLOR);
+	canvas.DrawCharHLine(INFO_ORIGIN, INFO_WIDTH, 24, ' ', BACKGROUND_COLOR, BACKGROUND_COLOR);
+
+	// Draw bottom info
+	canvas.DrawCenteredString(std::to_string(recordedNotesCount), INFO_ORIGIN, 18, INFO_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+	if (isQuantized) {
+		canvas.DrawCenteredString(LevelRecord::QUANTIZE_ON, INFO_ORIGIN, 24, INFO_WIDTH, BACKGROUND_COLOR, GOOD_COLOR);
+	} else {
+		canvas.DrawCenteredString(LevelRecord::QUANTIZE_OFF, INFO_ORIGIN, 24, INFO_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+	}
+}
+
 void idViewManager::DrawSelectUI(const std::string* levelNames, const size_t size) {
 	const int UI_X_ORIGIN = CONSOLE_WIDTH - UI_WIDTH;
 	const int UI_LIST_ORIGIN_X = UI_X_ORIGIN + 4 + int(LevelSelect::SELECTION_CURSOR.length());
@@ -174,7 +269,7 @@ void idViewManager::DrawSelectUI(const std::string* levelNames, const size_t siz
 	canvas.DrawMultilineString(LevelSelect::INSTRUCTIONS, 0, 4, BACKGROUND_COLOR, TEXT_COLOR, true, UI_X_ORIGIN);
 }
 
-void idViewManager::UpdateSelectUI(const size_t index, unsigned int highScore) {
+void idViewManager::UpdateSelectUI(const size_t index, unsigned int highScore, const size_t difficultyIndex, const size_t difficultyCount) {
 	const int UI_X_ORIGIN = CONSOLE_WIDTH - UI_WIDTH;
 	const int UI_ARROW_ORIGIN_X = UI_X_ORIGIN + 3;
 	const int UI_SCORE_ORIGIN_Y = 10;
@@ -192,6 +287,14 @@ void idViewManager::UpdateSelectUI(const size_t index, unsigned int highScore) {
 
 	canvas.DrawCharHLine(UI_X_ORIGIN+1, UI_WIDTH-2, UI_SCORE_ORIGIN_Y, ' ', BACKGROUND_COLOR, TEXT_COLOR);
 	canvas.DrawCenteredString(std::to_string(highScore), UI_X_ORIGIN, UI_SCORE_ORIGIN_Y, UI_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+
+	// Difficulty is only displayed for songs that have more than one
+	canvas.DrawCharHLine(UI_X_ORIGIN+1, UI_WIDTH-2, UI_SCORE_ORIGIN_Y + 2, ' ', BACKGROUND_COLOR, TEXT_COLOR);
+	if (difficultyCount > 1) {
+		const std::string difficultyString = "< " + LevelSelect::DIFFICULTY_TITLE + " " +
+			std::to_string(difficultyIndex + 1) + "/" + std::to_string(difficultyCount) + " >";
+		canvas.DrawCenteredString(difficultyString, UI_X_ORIGIN, UI_SCORE_ORIGIN_Y + 2, UI_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+	}
 }
 
 void idViewManager::DrawConfirmedUI(const size_t index) {
@@ -252,8 +355,10 @@ void idViewManager::UpdateResults(const bool doDisplayPrompt) {
 
 	if (doDisplayPrompt) {
 		canvas.DrawCenteredString(LevelResults::EXIT_SCREEN_TITLE, TEXT_ORIGIN, CONSOLE_HEIGHT - 4, TEXT_MAX_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
+		canvas.DrawCenteredString(LevelResults::RETRY_TITLE, TEXT_ORIGIN, CONSOLE_HEIGHT - 3, TEXT_MAX_WIDTH, BACKGROUND_COLOR, TEXT_COLOR);
 	} else {
 		canvas.DrawCharHLine(TEXT_ORIGIN, TEXT_MAX_WIDTH, CONSOLE_HEIGHT - 4, ' ', BACKGROUND_COLOR, BACKGROUND_COLOR);
+		canvas.DrawCharHLine(TEXT_ORIGIN, TEXT_MAX_WIDTH, CONSOLE_HEIGHT - 3, ' ', BACKGROUND_COLOR, BACKGROUND_COLOR);
 	}
 }
 
@@ -1,6 +1,7 @@
 #ifndef __VIEW_MANAGER__
 #define __VIEW_MANAGER__
 
+#include <cstdint>
 #include <string>
 
 #include "ConsoleCanvas.h"
@@ -17,8 +18,18 @@ class idViewManager {
 		void DrawUIBorder();
 		void DrawUI(const std::string &songName, const int songLength);
 		void UpdateUI(const int timeSinceStart, const int score, const int comboCount, const bool isFullCombo, const int missedNotes, const int highScore, const bool isNewHighScore);
+		void DrawPauseMenu();
+		void DrawResumeCountdown(const int secondsLeft);
+		void DrawPerformanceOverlay(const float frameMilliseconds, const float outputLatencyMilliseconds, const bool isLatencyMeasured,
+			const float mixerLatencyMilliseconds, const unsigned int activeVoiceCount, const unsigned int voiceCount,
+			const float cachedMegabytes, const float bufferMegabytes, const float budgetMegabytes,
+			const unsigned int cacheHitCount, const unsigned int bufferLoadCount, const unsigned int evictionCount);
+		void ClearPerformanceOverlay();
+		void DrawSpectrum(const uint8_t* const bandLevels, const size_t bandCount, const uint8_t maxLevel);
+		void DrawRecordUI(const std::string &songName, const int songLength);
+		void UpdateRecordUI(const int timeSinceStart, const int recordedNotesCount, const bool isQuantized);
 		void DrawSelectUI(const std::string* levelNames, const size_t size);
-		void UpdateSelectUI(const size_t index, unsigned int highScore);
+		void UpdateSelectUI(const size_t index, unsigned int highScore, const size_t difficultyIndex, const size_t difficultyCount);
 		void DrawConfirmedUI(const size_t index);
 		void ClearUI();
 		void ClearConsole();
@@ -8,6 +8,8 @@ namespace PathConstants {
 		const std::string LEVELS_DIR = DIR + "songs\\";
 		const std::string LEVEL_LIST = DIR + "songs_list.txt";
 		const std::string LEVEL_HIGH_SCORES = DIR + "scores.txt";
+		const std::string RECORDED_LEVEL_SUFFIX = "_recorded.txt";
+		const std::string COMPRESSED_RECORDED_LEVEL_SUFFIX = "_recorded.lvl";
 	}
 
 	namespace Audio {
@@ -20,6 +22,8 @@ namespace PathConstants {
 			const std::string MENU_CONFIRM = EFFECTS_DIR + "menu_confirm.wav";
 			const std::string MENU_BACK = EFFECTS_DIR + "menu_back.wav";
 			const std::string COMBO_BREAK = EFFECTS_DIR + "combo_break.wav";
+			const std::string NOTE_HIT = EFFECTS_DIR + "note_hit.wav";
+			const std::string ASSIST_TICK = EFFECTS_DIR + "assist_tick.wav";
 		}
 	}
 }
\ No newline at end of file
@@ -11,6 +11,8 @@ namespace PathConstants {
 		extern const std::string LEVELS_DIR; // Directory path for levels
 		extern const std::string LEVEL_LIST; // File path for level list
 		extern const std::string LEVEL_HIGH_SCORES; // File path for high scores on levels
+		extern const std::string RECORDED_LEVEL_SUFFIX; // Suffix replacing the extension of recorded level files
+		extern const std::string COMPRESSED_RECORDED_LEVEL_SUFFIX; // Same as RECORDED_LEVEL_SUFFIX, for compressed level files
 	}
 
 	namespace Audio {
@@ -23,6 +25,8 @@ namespace PathConstants {
 			extern const std::string MENU_CONFIRM; // File path for menu confirmation sound effect
 			extern const std::string MENU_BACK; // File path for menu "return" sound effect
 			extern const std::string COMBO_BREAK; // File path for "breaking a combo" sound effect
+			extern const std::string NOTE_HIT; // File path for the keysound played on each hit note
+			extern const std::string ASSIST_TICK; // File path for the tick played on the start of each note
 		}
 	}
 }
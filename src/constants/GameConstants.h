@@ -3,5 +3,6 @@
 
 #define GAME_LANE_COUNT 4
 #define MAX_LEVEL_COUNT 32
+#define MAX_CHECKPOINT_COUNT 16
 
 #endif
@@ -6,13 +6,27 @@ namespace KeyConstants {
 	const char LANE_KEYS[GAME_LANE_COUNT] = { 'S', 'D', 'F', 'G' };
 	const char MENU_PREVIOUS = VK_UP;
 	const char MENU_NEXT = VK_DOWN;
+	const char MENU_DIFFICULTY_PREVIOUS = VK_LEFT;
+	const char MENU_DIFFICULTY_NEXT = VK_RIGHT;
 	const char MENU_CONFIRM = VK_RETURN;
 	const char APPLICATION_EXIT = VK_ESCAPE;
+	const char MENU_RECORD = 'R';
+	const char RECORD_QUANTIZE = 'Q';
+	const char RESULTS_RETRY = 'R';
+	const char PAUSE_REWIND = 'R';
+	const char PERFORMANCE_OVERLAY_TOGGLE = VK_F3;
 	
 	namespace AsString {
 		const std::string MENU_PREVIOUS = "UP ARROW";
 		const std::string MENU_NEXT = "DOWN ARROW";
+		const std::string MENU_DIFFICULTY_PREVIOUS = "LEFT ARROW";
+		const std::string MENU_DIFFICULTY_NEXT = "RIGHT ARROW";
 		const std::string MENU_CONFIRM = "ENTER";
 		const std::string APPLICATION_EXIT = "ESCAPE";
+		const std::string MENU_RECORD = "R";
+		const std::string RECORD_QUANTIZE = "Q";
+		const std::string RESULTS_RETRY = "R";
+		const std::string PAUSE_REWIND = "R";
+		const std::string PERFORMANCE_OVERLAY_TOGGLE = "F3";
 	}
 }
@@ -9,14 +9,28 @@ namespace KeyConstants {
 	extern const char LANE_KEYS[GAME_LANE_COUNT];
 	extern const char MENU_PREVIOUS;
 	extern const char MENU_NEXT;
+	extern const char MENU_DIFFICULTY_PREVIOUS;
+	extern const char MENU_DIFFICULTY_NEXT;
 	extern const char MENU_CONFIRM;
 	extern const char APPLICATION_EXIT;
+	extern const char MENU_RECORD;
+	extern const char RECORD_QUANTIZE;
+	extern const char RESULTS_RETRY;
+	extern const char PAUSE_REWIND;
+	extern const char PERFORMANCE_OVERLAY_TOGGLE;
 
 	namespace AsString {
 		extern const std::string MENU_PREVIOUS;
 		extern const std::string MENU_NEXT;
+		extern const std::string MENU_DIFFICULTY_PREVIOUS;
+		extern const std::string MENU_DIFFICULTY_NEXT;
 		extern const std::string MENU_CONFIRM;
 		extern const std::string APPLICATION_EXIT;
+		extern const std::string MENU_RECORD;
+		extern const std::string RECORD_QUANTIZE;
+		extern const std::string RESULTS_RETRY;
+		extern const std::string PAUSE_REWIND;
+		extern const std::string PERFORMANCE_OVERLAY_TOGGLE;
 	}
 }
 
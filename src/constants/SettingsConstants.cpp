@@ -8,4 +8,37 @@ namespace GameplaySettingsConstants {
 	const float LATE_PRESS_TOLERANCE_SECONDS = 0.15f;
 	const float EARLY_RELEASE_TOLERANCE_SECONDS = 0.2f;
 	const float MAX_MISS_TIME_DISTANCE_SECONDS = 0.15f;
+}
+
+namespace MenuSettingsConstants {
+	const float CONFIRM_DISPLAY_SECONDS = 1.0f;
+	const float PREVIEW_DURATION_SECONDS = 12.0f;
+	const float DEFAULT_PREVIEW_START_RATIO = 0.4f;
+}
+
+namespace AudioSettingsConstants {
+	const bool SONG_STREAMING = true;
+	const bool KEYSOUNDS = true;
+	const bool OUTPUT_LATENCY_COMPENSATION = true;
+	const unsigned int SOUND_CACHE_BUDGET_MB = 256;
+	const bool ASSIST_TICKS = false;
+	const float ASSIST_TICK_LOOKAHEAD_SECONDS = 0.15f;
+	const bool SPECTRUM_VISUALIZER = true;
+}
+
+namespace PauseSettingsConstants {
+	const float RESUME_COUNTDOWN_SECONDS = 3.0f;
+	const float CHECKPOINT_INTERVAL_SECONDS = 5.0f;
+	const float MIN_REWIND_SECONDS = 1.0f;
+}
+
+namespace ChartAuthoringSettingsConstants {
+	const bool WATCH_PLAYED_LEVEL = true;
+}
+
+namespace RecordingSettingsConstants {
+	const unsigned int CAPTURE_POLL_INTERVAL_MS = 1;
+	const float MIN_NOTE_DURATION_SECONDS = 0.1f;
+	const float QUANTIZE_STEP_SECONDS = 0.025f;
+	const bool SAVE_COMPRESSED_LEVELS = false;
 }
\ No newline at end of file
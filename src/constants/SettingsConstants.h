@@ -11,4 +11,37 @@ namespace GameplaySettingsConstants {
 	extern const float MAX_MISS_TIME_DISTANCE_SECONDS; // Maximum distance at which misses will be counted
 }
 
+namespace MenuSettingsConstants {
+	extern const float CONFIRM_DISPLAY_SECONDS; // Minimum duration of the confirmation shown when a level is selected
+	extern const float PREVIEW_DURATION_SECONDS; // Duration of the looped song excerpt played while a song is highlighted
+	extern const float DEFAULT_PREVIEW_START_RATIO; // Start of the excerpt in the song when its level doesn't give one
+}
+
+namespace AudioSettingsConstants {
+	extern const bool SONG_STREAMING; // Whether songs are streamed from disk instead of being fully loaded
+	extern const bool KEYSOUNDS; // Whether a keysound is played on each hit note
+	extern const bool OUTPUT_LATENCY_COMPENSATION; // Whether the song clock is delayed by the audio output latency
+	extern const unsigned int SOUND_CACHE_BUDGET_MB; // Memory kept by loaded sounds before unused ones are deleted
+	extern const bool ASSIST_TICKS; // Whether a tick is played on the start of each note, on time whether it's hit or not
+	extern const float ASSIST_TICK_LOOKAHEAD_SECONDS; // How early ticks are scheduled before they play
+	extern const bool SPECTRUM_VISUALIZER; // Whether the spectrum of the played song is drawn under the level UI
+}
+
+namespace PauseSettingsConstants {
+	extern const float RESUME_COUNTDOWN_SECONDS; // Duration of the countdown played before resuming a level
+	extern const float CHECKPOINT_INTERVAL_SECONDS; // Time between two checkpoints of a level
+	extern const float MIN_REWIND_SECONDS; // Minimum time skipped back when rewinding to a checkpoint
+}
+
+namespace ChartAuthoringSettingsConstants {
+	extern const bool WATCH_PLAYED_LEVEL; // Whether the played level file is reloaded when it changes on disk
+}
+
+namespace RecordingSettingsConstants {
+	extern const unsigned int CAPTURE_POLL_INTERVAL_MS; // Delay between two samplings of lane keys while recording
+	extern const float MIN_NOTE_DURATION_SECONDS; // Minimum duration of a recorded note
+	extern const float QUANTIZE_STEP_SECONDS; // Grid on which recorded notes are snapped when quantizing
+	extern const bool SAVE_COMPRESSED_LEVELS; // Whether recorded levels are saved in the compressed format rather than as text
+}
+
 #endif
@@ -17,7 +17,11 @@ static std::string GetInstructions() {
 	strStream << "CHOOSING A SONG\n\n\n";
 	strStream << "Use '" << KeyConstants::AsString::MENU_NEXT << "' and '" << KeyConstants::AsString::MENU_PREVIOUS <<
 	             "'\nto select a song.\n\n";
-	strStream << "Then, press '" << KeyConstants::AsString::MENU_CONFIRM << "' to confirm.";
+	strStream << "Use '" << KeyConstants::AsString::MENU_DIFFICULTY_PREVIOUS << "' and '" << KeyConstants::AsString::MENU_DIFFICULTY_NEXT <<
+	             "'\nto change its difficulty.\n\n";
+	strStream << "Then, press '" << KeyConstants::AsString::MENU_CONFIRM << "' to confirm.\n\n";
+	strStream << "Press '" << KeyConstants::AsString::MENU_RECORD << "' instead to record a new chart\n";
+	strStream << "('" << KeyConstants::AsString::RECORD_QUANTIZE << "' toggles quantization).";
 	strStream << sectionSeparator;
 
 	// PLAYING THE GAME
@@ -41,6 +45,7 @@ namespace StringConstants {
 		const std::string MAIN_TITLE = "SELECT A SONG";
 		const std::string SELECTION_CURSOR = ">";
 		const std::string HIGH_SCORE_TITLE = "HIGH SCORE";
+		const std::string DIFFICULTY_TITLE = "DIFFICULTY";
 		const std::string INSTRUCTIONS = GetInstructions();
 	}
 
@@ -50,6 +55,33 @@ namespace StringConstants {
 		const std::string FULL_COMBO_SUFFIX = " (FULL)";
 		const std::string MISSED_NOTES_COUNT_TITLE = "MISS";
 		const std::string HIGH_SCORE_TITLE = "HIGH SCORE";
+		const std::string PAUSE_TITLE = "PAUSED";
+		const std::string PAUSE_INSTRUCTIONS =
+			std::string("'") + KeyConstants::AsString::MENU_CONFIRM + std::string("' : RESUME\n\n") +
+			std::string("'") + KeyConstants::AsString::PAUSE_REWIND + std::string("' : REWIND TO CHECKPOINT\n\n") +
+			std::string("'") + KeyConstants::AsString::APPLICATION_EXIT + std::string("' : QUIT SONG");
+	}
+
+	namespace LevelRecord {
+		const std::string RECORDING_TITLE = "- RECORDING -";
+		const std::string RECORDED_NOTES_COUNT_TITLE = "RECORDED NOTES";
+		const std::string QUANTIZE_TITLE =
+			std::string("QUANTIZE ('") +
+			KeyConstants::AsString::RECORD_QUANTIZE +
+			std::string("')");
+		const std::string QUANTIZE_ON = "ON";
+		const std::string QUANTIZE_OFF = "OFF";
+	}
+
+	namespace PerformanceOverlay {
+		const std::string FRAME_TIME_TITLE = "FRAME ";
+		const std::string OUTPUT_LATENCY_TITLE = "AUDIO ";
+		const std::string ESTIMATED_SUFFIX = "?";
+		const std::string VOICES_TITLE = "VOICES ";
+		const std::string CACHE_TITLE = "CACHE ";
+		const std::string BUFFERS_TITLE = "SOUNDS ";
+		const std::string CACHE_HITS_TITLE = "HIT ";
+		const std::string EVICTIONS_TITLE = "EVICT ";
 	}
 
 	namespace LevelResults {
@@ -62,5 +94,9 @@ namespace StringConstants {
 			std::string("PRESS '") +
 			KeyConstants::AsString::MENU_CONFIRM +
 			std::string("' TO CONTINUE");
+		const std::string RETRY_TITLE =
+			std::string("PRESS '") +
+			KeyConstants::AsString::RESULTS_RETRY +
+			std::string("' TO RETRY");
 	}
 }
@@ -8,6 +8,7 @@ namespace StringConstants {
 		extern const std::string MAIN_TITLE;
 		extern const std::string SELECTION_CURSOR;
 		extern const std::string HIGH_SCORE_TITLE;
+		extern const std::string DIFFICULTY_TITLE;
 		extern const std::string INSTRUCTIONS;
 	}
 	namespace LevelPlay {
@@ -16,6 +17,25 @@ namespace StringConstants {
 		extern const std::string FULL_COMBO_SUFFIX;
 		extern const std::string MISSED_NOTES_COUNT_TITLE;
 		extern const std::string HIGH_SCORE_TITLE;
+		extern const std::string PAUSE_TITLE;
+		extern const std::string PAUSE_INSTRUCTIONS;
+	}
+	namespace PerformanceOverlay {
+		extern const std::string FRAME_TIME_TITLE;
+		extern const std::string OUTPUT_LATENCY_TITLE;
+		extern const std::string ESTIMATED_SUFFIX;
+		extern const std::string VOICES_TITLE;
+		extern const std::string CACHE_TITLE;
+		extern const std::string BUFFERS_TITLE;
+		extern const std::string CACHE_HITS_TITLE;
+		extern const std::string EVICTIONS_TITLE;
+	}
+	namespace LevelRecord {
+		extern const std::string RECORDING_TITLE;
+		extern const std::string RECORDED_NOTES_COUNT_TITLE;
+		extern const std::string QUANTIZE_TITLE;
+		extern const std::string QUANTIZE_ON;
+		extern const std::string QUANTIZE_OFF;
 	}
 	namespace LevelResults {
 		extern const std::string ACCURACY_TITLE;
@@ -24,6 +44,7 @@ namespace StringConstants {
 		extern const std::string SCORE_TITLE;
 		extern const std::string NEW_HIGH_SCORE_TITLE;
 		extern const std::string EXIT_SCREEN_TITLE;
+		extern const std::string RETRY_TITLE;
 	}
 }
 
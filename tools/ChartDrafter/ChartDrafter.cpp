@@ -0,0 +1,325 @@
+// Drafts levels from songs by detecting note onsets in their audio, to be finished by hand.
+//
+// Usage : ChartDrafter <songs directory> <output levels directory> [songs list file]
+//
+// Each WAV file is reduced to mono and cut in overlapping frames, whose spectra are computed in
+// parallel over all cores. Onsets are the peaks of the spectral flux (the sum of magnitude increases
+// between two frames), and each note is placed on the lane of the frequency band whose flux rose
+// the most : low bands on the left lanes, high ones on the right lanes. Levels are written in the
+// text format, named after their song, with a preview starting at the densest part of the song.
+// Songs list appends stop at the game's song limit.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "constants/GameConstants.h"
+#include "MappedFile.h"
+#include "SoundUtils.h"
+#include "Fft.h"
+#include "MusicNote.h"
+#include "GameLevel.h"
+#include "../ToolUtils.h"
+
+namespace fs = std::filesystem;
+
+namespace DraftSettingsConstants {
+	const size_t FRAME_SIZE = 1024; // Samples analysed at once (23ms at 44.1kHz)
+	const size_t HOP_SIZE = 512; // Samples between the starts of two frames
+	const float BAND_EDGES_HZ[GAME_LANE_COUNT - 1] = { 150.0f, 600.0f, 3000.0f }; // Limits between the bands of the lanes
+	const float PEAK_WINDOW_SECONDS = 0.035f; // An onset is the highest flux this close to it
+	const float MEAN_WINDOW_SECONDS = 0.1f; // Flux is compared to its mean over this time around the onset
+	const float THRESHOLD_DEVIATIONS = 0.5f; // Minimum flux above the local mean, in standard deviations of the song flux
+	const float MIN_NOTE_GAP_SECONDS = 0.12f; // Minimum time between two notes
+	const float TAP_DURATION_SECONDS = 0.1f; // Duration given to notes
+	const float LANE_LENGTH_SECONDS = 1.8f; // Time for a note to travel a lane
+	const float PREVIEW_DURATION_SECONDS = 12.0f; // Window in which notes are counted to place the preview
+	const std::string LEVEL_EXTENSION = ".txt";
+}
+
+// Flux of every frequency band between each frame and the previous one
+struct onsetEnvelope_t {
+	std::vector<float> bandFluxes; // GAME_LANE_COUNT values per frame
+	size_t frameCount;
+	float framesPerSecond;
+};
+
+// Reads the sound data as mono floats in [-1, 1), whatever its format
+static bool ReadMonoSamples(const std::string &fileName, std::vector<float> &samples, int32_t &sampleRate) {
+	idMappedFile file;
+	wavFormat_t format;
+	const char* soundData;
+	uint32_t soundDataSize;
+	if (!file.Open(fileName) || !ParseWavFile(file.GetData(), file.GetSize(), format, soundData, soundDataSize)) {
+		return false;
+	}
+
+	// Every format can be converted (or decoded) to 16-bit samples
+	std::vector<int16_t> interleaved(GetConvertedWavDataSize(format, sampleType_t::INT16, soundDataSize) / sizeof(int16_t));
+	if (interleaved.empty() ||
+		!ConvertWavData(format, soundData, soundDataSize, reinterpret_cast<char*>(&interleaved[0]), sampleType_t::INT16, nullptr)) {
+		return false;
+	}
+
+	const size_t channelCount = size_t(format.numChannels);
+	const float scale = 1.0f / (32768.0f * float(channelCount));
+	samples.resize(interleaved.size() / channelCount);
+	for (size_t frame = 0; frame < samples.size(); ++frame) {
+		int32_t sum = 0;
+		for (size_t channel = 0; channel < channelCount; ++channel) {
+			sum += interleaved[frame * channelCount + channel];
+		}
+		samples[frame] = float(sum) * scale;
+	}
+	sampleRate = format.sampleRate;
+
+	return true;
+}
+
+// Computes the band fluxes of frames [firstFrame, endFrame), starting from the spectrum of the previous frame
+static void ComputeBandFluxes(
+	const std::vector<float> &samples,
+	const std::vector<size_t> &binBands,
+	const size_t firstFrame,
+	const size_t endFrame,
+	float* const bandFluxes) {
+	idFft fft;
+	fft.Init(DraftSettingsConstants::FRAME_SIZE);
+	std::vector<float> magnitudes(fft.GetBinCount());
+	std::vector<float> logMagnitudes(fft.GetBinCount(), 0.0f);
+	std::vector<float> previousLogMagnitudes(fft.GetBinCount(), 0.0f);
+
+	const size_t startFrame = (firstFrame > 0) ? (firstFrame - 1) : 0;
+	for (size_t frame = startFrame; frame < endFrame; ++frame) {
+		// Log compression keeps loud bands from hiding changes in quieter ones
+		fft.ComputeMagnitudes(&samples[frame * DraftSettingsConstants::HOP_SIZE], &magnitudes[0]);
+		for (size_t bin = 0; bin < magnitudes.size(); ++bin) {
+			logMagnitudes[bin] = std::log(1.0f + 100.0f * magnitudes[bin]);
+		}
+
+		if ((frame >= firstFrame) && (frame > 0)) {
+			float* const fluxes = bandFluxes + frame * GAME_LANE_COUNT;
+			for (size_t bin = 0; bin < magnitudes.size(); ++bin) {
+				const float increase = logMagnitudes[bin] - previousLogMagnitudes[bin];
+				if (increase > 0.0f) {
+					fluxes[binBands[bin]] += increase;
+				}
+			}
+		}
+		logMagnitudes.swap(previousLogMagnitudes);
+	}
+}
+
+static bool ComputeOnsetEnvelope(const std::vector<float> &samples, const int32_t sampleRate, onsetEnvelope_t &envelope) {
+	if (samples.size() < DraftSettingsConstants::FRAME_SIZE) {
+		return false;
+	}
+	envelope.frameCount = (samples.size() - DraftSettingsConstants::FRAME_SIZE) / DraftSettingsConstants::HOP_SIZE + 1;
+	envelope.framesPerSecond = float(sampleRate) / float(DraftSettingsConstants::HOP_SIZE);
+	envelope.bandFluxes.assign(envelope.frameCount * GAME_LANE_COUNT, 0.0f);
+
+	// Band of each frequency bin
+	const size_t binCount = DraftSettingsConstants::FRAME_SIZE / 2 + 1;
+	std::vector<size_t> binBands(binCount);
+	for (size_t bin = 0; bin < binCount; ++bin) {
+		const float frequency = float(bin) * float(sampleRate) / float(DraftSettingsConstants::FRAME_SIZE);
+		size_t band = 0;
+		while ((band < GAME_LANE_COUNT - 1) && (frequency >= DraftSettingsConstants::BAND_EDGES_HZ[band])) {
+			++band;
+		}
+		binBands[bin] = band;
+	}
+
+	// Frames are split in contiguous ranges, one per core
+	const size_t workerCount = (std::min)(size_t((std::max)(1u, std::thread::hardware_concurrency())), envelope.frameCount);
+	const size_t framesPerWorker = (envelope.frameCount + workerCount - 1) / workerCount;
+	std::vector<std::thread> workers;
+	for (size_t firstFrame = 0; firstFrame < envelope.frameCount; firstFrame += framesPerWorker) {
+		const size_t endFrame = (std::min)(firstFrame + framesPerWorker, envelope.frameCount);
+		workers.emplace_back(ComputeBandFluxes, std::cref(samples), std::cref(binBands), firstFrame, endFrame, &envelope.bandFluxes[0]);
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	return true;
+}
+
+// Picks the peaks of the total flux standing out of their surroundings, the lane being the band
+// whose flux rose the most relatively to its mean over the song
+static std::vector<idMusicNote> PickOnsets(const onsetEnvelope_t &envelope) {
+	const size_t frameCount = envelope.frameCount;
+	std::vector<float> flux(frameCount, 0.0f);
+	float bandMeans[GAME_LANE_COUNT] = {};
+	for (size_t frame = 0; frame < frameCount; ++frame) {
+		for (unsigned int band = 0; band < GAME_LANE_COUNT; ++band) {
+			flux[frame] += envelope.bandFluxes[frame * GAME_LANE_COUNT + band];
+			bandMeans[band] += envelope.bandFluxes[frame * GAME_LANE_COUNT + band] / float(frameCount);
+		}
+	}
+
+	double sum = 0.0, squaresSum = 0.0;
+	for (const float value : flux) {
+		sum += value;
+		squaresSum += double(value) * double(value);
+	}
+	const double mean = sum / double(frameCount);
+	const float deviation = float(std::sqrt((std::max)(0.0, squaresSum / double(frameCount) - mean * mean)));
+	const float threshold = deviation * DraftSettingsConstants::THRESHOLD_DEVIATIONS;
+
+	const size_t peakWindow = (std::max)(size_t(1), size_t(DraftSettingsConstants::PEAK_WINDOW_SECONDS * envelope.framesPerSecond));
+	const size_t meanWindow = (std::max)(size_t(1), size_t(DraftSettingsConstants::MEAN_WINDOW_SECONDS * envelope.framesPerSecond));
+	const size_t minGap = size_t(DraftSettingsConstants::MIN_NOTE_GAP_SECONDS * envelope.framesPerSecond);
+
+	std::vector<idMusicNote> notes;
+	size_t lastOnsetFrame = 0;
+	bool hasOnset = false;
+	for (size_t frame = 1; frame < frameCount; ++frame) {
+		const size_t peakStart = (frame > peakWindow) ? (frame - peakWindow) : 0;
+		const size_t peakEnd = (std::min)(frame + peakWindow + 1, frameCount);
+		if (*std::max_element(flux.begin() + peakStart, flux.begin() + peakEnd) > flux[frame]) {
+			continue;
+		}
+
+		const size_t meanStart = (frame > meanWindow) ? (frame - meanWindow) : 0;
+		const size_t meanEnd = (std::min)(frame + meanWindow + 1, frameCount);
+		float localMean = 0.0f;
+		for (size_t i = meanStart; i < meanEnd; ++i) {
+			localMean += flux[i];
+		}
+		localMean /= float(meanEnd - meanStart);
+		if ((flux[frame] < localMean + threshold) || (hasOnset && (frame - lastOnsetFrame < minGap))) {
+			continue;
+		}
+
+		int lane = 0;
+		float laneScore = 0.0f;
+		for (unsigned int band = 0; band < GAME_LANE_COUNT; ++band) {
+			const float score = (bandMeans[band] > 0.0f) ? (envelope.bandFluxes[frame * GAME_LANE_COUNT + band] / bandMeans[band]) : 0.0f;
+			if (score > laneScore) {
+				laneScore = score;
+				lane = int(band);
+			}
+		}
+
+		// Onset is placed at the center of the frame where the flux rose
+		idMusicNote note;
+		note.column = lane;
+		note.startSeconds = (float(frame) + 0.5f * float(DraftSettingsConstants::FRAME_SIZE / DraftSettingsConstants::HOP_SIZE)) / envelope.framesPerSecond;
+		note.endSeconds = note.startSeconds + DraftSettingsConstants::TAP_DURATION_SECONDS;
+		note.state = idMusicNote::state_t::ACTIVE;
+		notes.push_back(note);
+		lastOnsetFrame = frame;
+		hasOnset = true;
+	}
+
+	return notes;
+}
+
+// Start of the preview window holding the most notes
+static float FindPreviewStart(const std::vector<idMusicNote> &notes) {
+	float bestStart = 0.0f;
+	size_t bestCount = 0;
+	size_t windowEnd = 0;
+	for (size_t windowStart = 0; windowStart < notes.size(); ++windowStart) {
+		while ((windowEnd < notes.size()) &&
+			(notes[windowEnd].startSeconds < notes[windowStart].startSeconds + DraftSettingsConstants::PREVIEW_DURATION_SECONDS)) {
+			++windowEnd;
+		}
+		if (windowEnd - windowStart > bestCount) {
+			bestCount = windowEnd - windowStart;
+			bestStart = notes[windowStart].startSeconds;
+		}
+	}
+	return bestStart;
+}
+
+static bool IsWavFile(const fs::path &path) {
+	std::string extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](const char c) {
+		return ((c >= 'A') && (c <= 'Z')) ? char(c - 'A' + 'a') : c;
+	});
+	return extension == ".wav";
+}
+
+// levelFileName must be set to a name no other drafted level uses
+static bool DraftLevel(const fs::path &songPath, const fs::path &outputDirectory, const std::string &levelFileName, size_t &noteCount) {
+	std::vector<float> samples;
+	int32_t sampleRate;
+	onsetEnvelope_t envelope;
+	if (!ReadMonoSamples(songPath.string(), samples, sampleRate) ||
+		!ComputeOnsetEnvelope(samples, sampleRate, envelope)) {
+		return false;
+	}
+	const std::vector<idMusicNote> notes = PickOnsets(envelope);
+	noteCount = notes.size();
+
+	idGameLevel level;
+	level.SetInfo(songPath.stem().string(), songPath.filename().string(),
+		float(samples.size()) / float(sampleRate),
+		DraftSettingsConstants::LANE_LENGTH_SECONDS);
+	level.SetPreviewSeconds(FindPreviewStart(notes));
+	level.SetNotes(notes);
+
+	return level.SaveFile((outputDirectory / levelFileName).string());
+}
+
+int main(int argc, char* argv[]) {
+	if ((argc < 3) || (argc > 4)) {
+		std::fprintf(stderr, "Usage : %s <songs directory> <output levels directory> [songs list file]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	const fs::path inputDirectory(argv[1]);
+	const fs::path outputDirectory(argv[2]);
+
+	// List song files
+	std::error_code error;
+	std::vector<fs::path> songFiles;
+	for (fs::directory_iterator i(inputDirectory, error), end; !error && (i != end); i.increment(error)) {
+		if (i->is_regular_file() && IsWavFile(i->path())) {
+			songFiles.push_back(i->path());
+		}
+	}
+	if (error) {
+		std::fprintf(stderr, "Can't read directory %s\n", inputDirectory.string().c_str());
+		return EXIT_FAILURE;
+	}
+	std::sort(songFiles.begin(), songFiles.end());
+	fs::create_directories(outputDirectory, error);
+
+	// Songs are drafted one after the other, each one using every core
+	std::vector<std::string> songEntries;
+	std::unordered_set<std::string> takenFileNames;
+	for (const fs::path &songFile : songFiles) {
+		const std::string levelName = SanitizeFileName(songFile.stem().string());
+		std::string levelFileName = levelName + DraftSettingsConstants::LEVEL_EXTENSION;
+		for (unsigned int suffix = 2; takenFileNames.count(levelFileName) > 0; ++suffix) {
+			levelFileName = levelName + "_" + std::to_string(suffix) + DraftSettingsConstants::LEVEL_EXTENSION;
+		}
+		size_t noteCount;
+		if (!DraftLevel(songFile, outputDirectory, levelFileName, noteCount)) {
+			std::fprintf(stderr, "Skipped %s (not a readable WAV file)\n", songFile.string().c_str());
+			continue;
+		}
+		takenFileNames.insert(levelFileName);
+		std::printf("Drafted %s (%zu notes)\n", levelFileName.c_str(), noteCount);
+		songEntries.push_back(levelFileName + " " + songFile.stem().string());
+	}
+
+	if ((argc == 4) && !AppendSongsListEntries(argv[3], songEntries)) {
+		std::fprintf(stderr, "Can't write songs list %s\n", argv[3]);
+		return EXIT_FAILURE;
+	}
+
+	std::printf("Drafted %zu levels from %zu files\n", songEntries.size(), songFiles.size());
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,545 @@
+// Converts 4-key community charts into compressed game levels.
+//
+// Usage : ChartImporter <charts directory> <output levels directory> [songs list file]
+//
+// Supported formats :
+//  - osu!mania beatmaps (.osu, Mode 3 with 4 keys), difficulties of a song being separate files
+//  - StepMania simfiles (.sm, "dance-single" charts), one level being written per difficulty
+//
+// Every chart file is read once into memory and parsed in a single pass over it, files being
+// spread over all cores. Level file names are built from the path of the chart in the charts
+// directory and made unique before any file is written. Difficulties sharing the same song are
+// grouped into one songs list entry, entries past the game's song limit being skipped. Audio files
+// are referenced with a ".wav" extension, they must be converted separately.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "constants/GameConstants.h"
+#include "MusicNote.h"
+#include "GameLevel.h"
+#include "../ToolUtils.h"
+
+namespace fs = std::filesystem;
+
+namespace ImportSettingsConstants {
+	const float TAP_DURATION_SECONDS = 0.1f; // Duration given to notes that aren't holds
+	const float LANE_LENGTH_SECONDS = 1.8f; // Time for a note to travel a lane
+	const float END_PADDING_SECONDS = 2.0f; // Time kept after the last note before the level ends
+	const std::string LEVEL_EXTENSION = ".lvl";
+	const std::string AUDIO_EXTENSION = ".wav";
+}
+
+// Level parsed from a chart file, before being written
+struct importedLevel_t {
+	std::string difficultyName;
+	std::vector<idMusicNote> notes;
+	std::string fileName; // Unique among all imported levels
+};
+
+// Every level parsed from a chart file
+struct importedChart_t {
+	std::string songName;
+	std::string audioFileName;
+	std::string groupKey; // Charts with the same key are difficulties of the same song
+	std::vector<importedLevel_t> levels;
+	bool isValid;
+	bool isWritten;
+};
+
+// # Parsing helpers (all working on views into the file buffer, nothing is allocated per line)
+
+static std::string_view Trim(std::string_view text) {
+	while (!text.empty() && ((text.front() == ' ') || (text.front() == '\t') || (text.front() == '\r') || (text.front() == '\n'))) {
+		text.remove_prefix(1);
+	}
+	while (!text.empty() && ((text.back() == ' ') || (text.back() == '\t') || (text.back() == '\r') || (text.back() == '\n'))) {
+		text.remove_suffix(1);
+	}
+	return text;
+}
+
+// Extracts the next line (without line ending) and advances the cursor past it
+static bool NextLine(std::string_view &cursor, std::string_view &line) {
+	if (cursor.empty()) {
+		return false;
+	}
+	const size_t end = cursor.find('\n');
+	line = cursor.substr(0, end);
+	cursor.remove_prefix((end == std::string_view::npos) ? cursor.size() : end + 1);
+	if (!line.empty() && (line.back() == '\r')) {
+		line.remove_suffix(1);
+	}
+	return true;
+}
+
+// Extracts the next field delimited by separator and advances the cursor past it
+static std::string_view NextField(std::string_view &cursor, const char separator) {
+	const size_t end = cursor.find(separator);
+	const std::string_view field = cursor.substr(0, end);
+	cursor.remove_prefix((end == std::string_view::npos) ? cursor.size() : end + 1);
+	return field;
+}
+
+static double ParseNumber(const std::string_view text) {
+	// strtod needs a terminated string, numbers are short enough for a stack buffer
+	char buffer[64];
+	const size_t length = (std::min)(text.size(), sizeof(buffer) - 1);
+	std::copy(text.begin(), text.begin() + length, buffer);
+	buffer[length] = '\0';
+	return std::strtod(buffer, nullptr);
+}
+
+static bool StartsWith(const std::string_view text, const std::string_view prefix) {
+	return (text.size() >= prefix.size()) && (text.compare(0, prefix.size(), prefix) == 0);
+}
+
+static std::string ReplaceExtension(const std::string_view fileName, const std::string &extension) {
+	const size_t dotIndex = fileName.find_last_of('.');
+	return std::string(fileName.substr(0, dotIndex)) + extension;
+}
+
+// # osu!mania
+
+static bool ParseOsuChart(const std::string_view data, const fs::path &filePath, importedChart_t &chart) {
+	enum class section_t { OTHER, GENERAL, METADATA, DIFFICULTY, HIT_OBJECTS };
+
+	section_t section = section_t::OTHER;
+	int mode = 0;
+	int keyCount = 0;
+	std::string_view title, artist, version, audioFileName;
+	importedLevel_t level;
+
+	std::string_view cursor = data;
+	std::string_view line;
+	while (NextLine(cursor, line)) {
+		line = Trim(line);
+		if (line.empty() || StartsWith(line, "//")) {
+			continue;
+		}
+
+		if (line.front() == '[') {
+			if (line == "[General]") {
+				section = section_t::GENERAL;
+			} else if (line == "[Metadata]") {
+				section = section_t::METADATA;
+			} else if (line == "[Difficulty]") {
+				section = section_t::DIFFICULTY;
+			} else if (line == "[HitObjects]") {
+				// Header sections come first, reject other modes before reading notes
+				if ((mode != 3) || (keyCount != GAME_LANE_COUNT)) {
+					return false;
+				}
+				section = section_t::HIT_OBJECTS;
+				level.notes.reserve(cursor.size() / 24); // Rough line length of a hit object
+			} else {
+				section = section_t::OTHER;
+			}
+			continue;
+		}
+
+		if (section == section_t::HIT_OBJECTS) {
+			// x,y,time,type,hitSound,endTime:hitSample
+			const int x = int(ParseNumber(NextField(line, ',')));
+			NextField(line, ',');
+			const double startMilliseconds = ParseNumber(NextField(line, ','));
+			const int type = int(ParseNumber(NextField(line, ',')));
+			NextField(line, ',');
+
+			const int column = (std::min)((std::max)(x * GAME_LANE_COUNT / 512, 0), GAME_LANE_COUNT - 1);
+			const float startSeconds = float(startMilliseconds / 1000.0);
+			float endSeconds = startSeconds + ImportSettingsConstants::TAP_DURATION_SECONDS;
+			if (type & 128) { // Hold note
+				endSeconds = float(ParseNumber(NextField(line, ':')) / 1000.0);
+			}
+			level.notes.emplace_back(column, startSeconds, endSeconds);
+			continue;
+		}
+
+		// Key: Value pairs
+		const size_t colonIndex = line.find(':');
+		if (colonIndex == std::string_view::npos) {
+			continue;
+		}
+		const std::string_view key = Trim(line.substr(0, colonIndex));
+		const std::string_view value = Trim(line.substr(colonIndex + 1));
+		if (section == section_t::GENERAL) {
+			if (key == "AudioFilename") {
+				audioFileName = value;
+			} else if (key == "Mode") {
+				mode = int(ParseNumber(value));
+			}
+		} else if (section == section_t::METADATA) {
+			if (key == "Title") {
+				title = value;
+			} else if (key == "Artist") {
+				artist = value;
+			} else if (key == "Version") {
+				version = value;
+			}
+		} else if (section == section_t::DIFFICULTY) {
+			if (key == "CircleSize") {
+				keyCount = int(ParseNumber(value));
+			}
+		}
+	}
+
+	if (level.notes.empty()) {
+		return false;
+	}
+
+	level.difficultyName = std::string(version);
+	chart.songName = std::string(artist) + " - " + std::string(title);
+	chart.audioFileName = ReplaceExtension(audioFileName, ImportSettingsConstants::AUDIO_EXTENSION);
+	// Difficulties of a beatmap set are separate files next to the same audio file
+	chart.groupKey = filePath.parent_path().string() + "|" + std::string(audioFileName);
+	chart.levels.push_back(std::move(level));
+
+	return true;
+}
+
+// # StepMania
+
+struct timingSegment_t {
+	double beat;
+	double value; // BPM for tempo changes, seconds for stops
+};
+
+static std::vector<timingSegment_t> ParseTimingSegments(std::string_view text) {
+	std::vector<timingSegment_t> segments;
+	while (!text.empty()) {
+		std::string_view pair = NextField(text, ',');
+		const std::string_view beat = Trim(NextField(pair, '='));
+		if (beat.empty()) {
+			continue;
+		}
+		timingSegment_t segment = { ParseNumber(beat), ParseNumber(Trim(pair)) };
+		segments.push_back(segment);
+	}
+	std::sort(segments.begin(), segments.end(),
+		[](const timingSegment_t &left, const timingSegment_t &right) { return left.beat < right.beat; });
+	return segments;
+}
+
+static double BeatToSeconds(const double beat, const double offset,
+	const std::vector<timingSegment_t> &bpms, const std::vector<timingSegment_t> &stops) {
+	// Integrate tempo changes up to the beat
+	double seconds = -offset;
+	for (size_t i = 0; i < bpms.size(); ++i) {
+		const double segmentStart = (i == 0) ? 0.0 : bpms[i].beat;
+		if (beat <= segmentStart) {
+			break;
+		}
+		const double segmentEnd = (i + 1 < bpms.size()) ? (std::min)(bpms[i + 1].beat, beat) : beat;
+		seconds += (segmentEnd - segmentStart) * 60.0 / bpms[i].value;
+	}
+
+	// Stops strictly before the beat delay it
+	for (const timingSegment_t &stop : stops) {
+		if (stop.beat >= beat) {
+			break;
+		}
+		seconds += stop.value;
+	}
+
+	return seconds;
+}
+
+static bool ParseSmNoteData(std::string_view noteData, const double offset,
+	const std::vector<timingSegment_t> &bpms, const std::vector<timingSegment_t> &stops, importedLevel_t &level) {
+	float holdStartSeconds[GAME_LANE_COUNT];
+	bool isHolding[GAME_LANE_COUNT] = {};
+
+	level.notes.reserve(noteData.size() / 10);
+	double measureStartBeat = 0.0;
+	while (!noteData.empty()) {
+		std::string_view measure = NextField(noteData, ',');
+
+		// First pass over the measure counts rows, which gives the length of a row in beats
+		size_t rowCount = 0;
+		std::string_view rowCursor = measure;
+		std::string_view row;
+		while (NextLine(rowCursor, row)) {
+			row = Trim(row.substr(0, row.find("//")));
+			if (row.size() >= GAME_LANE_COUNT) {
+				rowCount++;
+			}
+		}
+		if (rowCount == 0) {
+			continue;
+		}
+
+		size_t rowIndex = 0;
+		rowCursor = measure;
+		while (NextLine(rowCursor, row)) {
+			row = Trim(row.substr(0, row.find("//")));
+			if (row.size() < GAME_LANE_COUNT) {
+				continue;
+			}
+
+			const double beat = measureStartBeat + 4.0 * double(rowIndex++) / double(rowCount);
+			const float seconds = float(BeatToSeconds(beat, offset, bpms, stops));
+			for (int column = 0; column < GAME_LANE_COUNT; ++column) {
+				switch (row[column]) {
+					case '1': // Tap
+						level.notes.emplace_back(column, seconds, seconds + ImportSettingsConstants::TAP_DURATION_SECONDS);
+						break;
+					case '2': // Hold head
+					case '4': // Roll head
+						holdStartSeconds[column] = seconds;
+						isHolding[column] = true;
+						break;
+					case '3': // Hold or roll tail
+						if (isHolding[column]) {
+							level.notes.emplace_back(column, holdStartSeconds[column], seconds);
+							isHolding[column] = false;
+						}
+						break;
+					default: // Empty, mines, lifts and fakes
+						break;
+				}
+			}
+		}
+		measureStartBeat += 4.0;
+	}
+
+	return !level.notes.empty();
+}
+
+static bool ParseSmChart(const std::string_view data, const fs::path &filePath, importedChart_t &chart) {
+	std::string_view title, artist, music;
+	double offset = 0.0;
+	std::vector<timingSegment_t> bpms;
+	std::vector<timingSegment_t> stops;
+
+	// Tags are "#KEY:VALUE;" where values may span several lines
+	std::string_view cursor = data;
+	while (true) {
+		const size_t tagStart = cursor.find('#');
+		if (tagStart == std::string_view::npos) {
+			break;
+		}
+		cursor.remove_prefix(tagStart + 1);
+		const std::string_view key = NextField(cursor, ':');
+		std::string_view value = NextField(cursor, ';');
+
+		if (key == "TITLE") {
+			title = Trim(value);
+		} else if (key == "ARTIST") {
+			artist = Trim(value);
+		} else if (key == "MUSIC") {
+			music = Trim(value);
+		} else if (key == "OFFSET") {
+			offset = ParseNumber(Trim(value));
+		} else if (key == "BPMS") {
+			bpms = ParseTimingSegments(value);
+		} else if (key == "STOPS") {
+			stops = ParseTimingSegments(value);
+		} else if (key == "NOTES") {
+			// type:description:difficulty:meter:radar values:note data
+			const std::string_view type = Trim(NextField(value, ':'));
+			NextField(value, ':');
+			const std::string_view difficulty = Trim(NextField(value, ':'));
+			NextField(value, ':');
+			NextField(value, ':');
+			if ((type != "dance-single") || bpms.empty()) {
+				continue;
+			}
+
+			importedLevel_t level;
+			level.difficultyName = std::string(difficulty);
+			if (ParseSmNoteData(value, offset, bpms, stops, level)) {
+				chart.levels.push_back(std::move(level));
+			}
+		}
+	}
+
+	if (chart.levels.empty()) {
+		return false;
+	}
+
+	chart.songName = std::string(artist) + " - " + std::string(title);
+	chart.audioFileName = ReplaceExtension(music, ImportSettingsConstants::AUDIO_EXTENSION);
+	chart.groupKey = filePath.string(); // All difficulties are in the same file
+
+	return true;
+}
+
+// # Import
+
+// Runs task on every index, each worker picking the next index to process
+static void RunInParallel(const size_t count, const std::function<void(const size_t)> &task) {
+	std::atomic<size_t> nextIndex(0);
+	const unsigned int workerCount = (std::max)(1u, std::thread::hardware_concurrency());
+	std::vector<std::thread> workers;
+	for (unsigned int i = 0; i < workerCount; ++i) {
+		workers.emplace_back([&]() {
+			size_t index;
+			while ((index = nextIndex.fetch_add(1)) < count) {
+				task(index);
+			}
+		});
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+}
+
+static bool ParseChartFile(const fs::path &filePath, importedChart_t &chart) {
+	// Read the whole file at once, parsing then works on views into this buffer
+	std::ifstream file(filePath, std::ios_base::binary | std::ios_base::ate);
+	if (!file.good() || !file.is_open()) {
+		return false;
+	}
+	std::string data(size_t(file.tellg()), '\0');
+	file.seekg(0);
+	if (!data.empty() && file.read(&data[0], data.size()).fail()) {
+		return false;
+	}
+
+	const std::string extension = filePath.extension().string();
+	const bool isParsed = (extension == ".osu") ?
+		ParseOsuChart(data, filePath, chart) :
+		ParseSmChart(data, filePath, chart);
+	return isParsed;
+}
+
+// Names levels after the path of their chart relative to the charts directory ("a/song.osu" gives "a_song.lvl"),
+// a number being appended to names already taken by other charts
+static void AssignLevelFileNames(const fs::path &chartPath, const fs::path &inputDirectory,
+	importedChart_t &chart, std::unordered_set<std::string> &takenFileNames) {
+	fs::path relativePath = chartPath.lexically_relative(inputDirectory);
+	if (relativePath.empty()) {
+		relativePath = chartPath.filename();
+	}
+	const std::string baseName = SanitizeFileName(relativePath.replace_extension().generic_string());
+
+	for (importedLevel_t &importedLevel : chart.levels) {
+		std::string levelName = baseName;
+		if (chart.levels.size() > 1) {
+			levelName += "_" + SanitizeFileName(importedLevel.difficultyName);
+		}
+		importedLevel.fileName = levelName + ImportSettingsConstants::LEVEL_EXTENSION;
+		for (unsigned int suffix = 2; takenFileNames.count(importedLevel.fileName) > 0; ++suffix) {
+			importedLevel.fileName = levelName + "_" + std::to_string(suffix) + ImportSettingsConstants::LEVEL_EXTENSION;
+		}
+		takenFileNames.insert(importedLevel.fileName);
+	}
+}
+
+// Writes one level per difficulty
+static bool WriteChartLevels(const fs::path &outputDirectory, importedChart_t &chart) {
+	idGameLevel level;
+	for (importedLevel_t &importedLevel : chart.levels) {
+		float lastNoteEndSeconds = 0.0f;
+		for (const idMusicNote &note : importedLevel.notes) {
+			lastNoteEndSeconds = (std::max)(lastNoteEndSeconds, note.endSeconds);
+		}
+		level.SetInfo(chart.songName, chart.audioFileName,
+			lastNoteEndSeconds + ImportSettingsConstants::END_PADDING_SECONDS,
+			ImportSettingsConstants::LANE_LENGTH_SECONDS);
+		level.SetNotes(importedLevel.notes);
+
+		if (!level.SaveCompressedFile((outputDirectory / importedLevel.fileName).string())) {
+			return false;
+		}
+
+		importedLevel.notes = std::vector<idMusicNote>(); // Release memory early, only names are kept
+	}
+
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	if ((argc < 3) || (argc > 4)) {
+		std::fprintf(stderr, "Usage : %s <charts directory> <output levels directory> [songs list file]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	const fs::path inputDirectory(argv[1]);
+	const fs::path outputDirectory(argv[2]);
+
+	// List chart files
+	std::error_code error;
+	std::vector<fs::path> chartFiles;
+	for (fs::recursive_directory_iterator i(inputDirectory, error), end; !error && (i != end); i.increment(error)) {
+		const std::string extension = i->path().extension().string();
+		if (i->is_regular_file() && ((extension == ".osu") || (extension == ".sm"))) {
+			chartFiles.push_back(i->path());
+		}
+	}
+	if (error) {
+		std::fprintf(stderr, "Can't read directory %s\n", inputDirectory.string().c_str());
+		return EXIT_FAILURE;
+	}
+	std::sort(chartFiles.begin(), chartFiles.end());
+	fs::create_directories(outputDirectory, error);
+
+	// Parse files in parallel, then name their levels in file order so no two workers write the same file
+	std::vector<importedChart_t> charts(chartFiles.size());
+	RunInParallel(chartFiles.size(), [&](const size_t fileIndex) {
+		charts[fileIndex].isValid = ParseChartFile(chartFiles[fileIndex], charts[fileIndex]);
+	});
+	std::unordered_set<std::string> takenFileNames;
+	for (size_t i = 0; i < charts.size(); ++i) {
+		if (charts[i].isValid) {
+			AssignLevelFileNames(chartFiles[i], inputDirectory, charts[i], takenFileNames);
+		}
+	}
+	RunInParallel(charts.size(), [&](const size_t fileIndex) {
+		charts[fileIndex].isWritten = charts[fileIndex].isValid && WriteChartLevels(outputDirectory, charts[fileIndex]);
+	});
+
+	// Group difficulties of the same song into one songs list entry (keeping file order)
+	std::vector<std::pair<std::string, std::string>> songEntries; // Level file names, display name
+	std::unordered_map<std::string, size_t> songEntryIndices;
+	size_t importedLevelsCount = 0;
+	for (size_t i = 0; i < charts.size(); ++i) {
+		const importedChart_t &chart = charts[i];
+		if (!chart.isValid) {
+			std::fprintf(stderr, "Skipped %s (not a supported 4-key chart)\n", chartFiles[i].string().c_str());
+			continue;
+		}
+		if (!chart.isWritten) {
+			std::fprintf(stderr, "Skipped %s (can't write its levels)\n", chartFiles[i].string().c_str());
+			continue;
+		}
+
+		if (songEntryIndices.count(chart.groupKey) <= 0) {
+			songEntryIndices[chart.groupKey] = songEntries.size();
+			songEntries.emplace_back("", chart.songName);
+		}
+		std::string &levelFileNames = songEntries[songEntryIndices.at(chart.groupKey)].first;
+		for (const importedLevel_t &importedLevel : chart.levels) {
+			if (!levelFileNames.empty()) {
+				levelFileNames += ",";
+			}
+			levelFileNames += importedLevel.fileName;
+			importedLevelsCount++;
+		}
+	}
+
+	if (argc == 4) {
+		std::vector<std::string> songsListLines;
+		for (const std::pair<std::string, std::string> &songEntry : songEntries) {
+			songsListLines.push_back(songEntry.first + " " + songEntry.second);
+		}
+		if (!AppendSongsListEntries(argv[3], songsListLines)) {
+			std::fprintf(stderr, "Can't write songs list %s\n", argv[3]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::printf("Imported %zu levels from %zu files (%zu songs)\n", importedLevelsCount, chartFiles.size(), songEntries.size());
+	return EXIT_SUCCESS;
+}
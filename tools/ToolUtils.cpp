@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "constants/GameConstants.h"
+#include "ToolUtils.h"
+
+std::string SanitizeFileName(const std::string_view name) {
+	std::string res;
+	res.reserve(name.size());
+	for (const char c : name) {
+		if ((c >= 'A') && (c <= 'Z')) {
+			res.push_back(char(c - 'A' + 'a'));
+		} else if (((c >= 'a') && (c <= 'z')) || ((c >= '0') && (c <= '9'))) {
+			res.push_back(c);
+		} else if (!res.empty() && (res.back() != '_')) {
+			res.push_back('_');
+		}
+	}
+	while (!res.empty() && (res.back() == '_')) {
+		res.pop_back();
+	}
+	return res.empty() ? "level" : res;
+}
+
+size_t CountSongsListEntries(const std::string &songsListFileName) {
+	std::ifstream songsList(songsListFileName);
+	size_t count = 0;
+	std::string line;
+	while (std::getline(songsList, line)) {
+		if (line.find_first_not_of(" \t\r") != std::string::npos) {
+			count++;
+		}
+	}
+	return count;
+}
+
+bool AppendSongsListEntries(const std::string &songsListFileName, const std::vector<std::string> &songEntries) {
+	// The game refuses to start with more than MAX_LEVEL_COUNT songs
+	const size_t listedSongCount = CountSongsListEntries(songsListFileName);
+	const size_t addedSongCount = (std::min)(songEntries.size(), size_t(MAX_LEVEL_COUNT) - (std::min)(listedSongCount, size_t(MAX_LEVEL_COUNT)));
+	for (size_t i = addedSongCount; i < songEntries.size(); ++i) {
+		std::fprintf(stderr, "Not listed %s (songs list is full, %d songs at most)\n", songEntries[i].c_str(), MAX_LEVEL_COUNT);
+	}
+
+	std::ofstream songsList(songsListFileName, std::ios_base::app);
+	for (size_t i = 0; i < addedSongCount; ++i) {
+		songsList << songEntries[i] << "\n";
+	}
+	songsList.close();
+	return !songsList.fail();
+}
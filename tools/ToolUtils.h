@@ -0,0 +1,18 @@
+#ifndef __TOOL_UTILS__
+#define __TOOL_UTILS__
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Helpers shared by the level tools
+
+// Keeps file names portable : lowercase letters, digits and underscores (the songs list is split on spaces)
+std::string SanitizeFileName(const std::string_view name);
+// Songs already listed, one per non-empty line (0 if the list doesn't exist yet)
+size_t CountSongsListEntries(const std::string &songsListFileName);
+// Appends songs list lines ("<level files> <song name>") until the list holds the game's song limit,
+// entries past it are reported and skipped
+bool AppendSongsListEntries(const std::string &songsListFileName, const std::vector<std::string> &songEntries);
+
+#endif